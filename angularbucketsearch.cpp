@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "angularbucketsearch.hpp"
+
+AngularBucketSearch::AngularBucketSearch(const LatticeGraphCSR &graph,
+                                         const std::vector<Point2f> &locations)
+    : m_graph(graph), m_locations(locations),
+      m_buckets(static_cast<size_t>(MAX_TURN / BUCKET_WIDTH) + 2),
+      m_reachedIn(graph.getCellCount(), 0), m_settledIn(graph.getCellCount(), 0),
+      m_depth(graph.getCellCount(), 0.0), m_parent(graph.getCellCount(), LatticeGraphCSR::NO_CELL) {
+}
+
+void AngularBucketSearch::startRun() {
+    m_run++;
+    if (m_run == 0) {
+        // the stamps have wrapped around
+        std::fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+        std::fill(m_settledIn.begin(), m_settledIn.end(), 0);
+        m_run = 1;
+    }
+}
+
+void AngularBucketSearch::relax(uint32_t cell, double depth, uint32_t from, size_t &queued) {
+    if (m_reachedIn[cell] != m_run || depth < m_depth[cell]) {
+        m_reachedIn[cell] = m_run;
+        m_depth[cell] = depth;
+        m_parent[cell] = from;
+        size_t bucket = getBucket(depth);
+        if (bucket <= m_currentBucket) {
+            // straight on, or rounded into the bucket being emptied
+            m_current.push_back(Entry(depth, cell));
+            std::push_heap(m_current.begin(), m_current.end(), std::greater<Entry>());
+        } else {
+            m_buckets[bucket % m_buckets.size()].push_back(Entry(depth, cell));
+        }
+        queued++;
+    }
+}
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Least-angle search over a LatticeGraphCSR with the angular depths
+// quantised into buckets of BUCKET_WIDTH. No turn is more than two right
+// angles, so the buckets are a ring of fixed size and queueing a cell is an
+// append. Only the bucket being emptied is kept in order, as a small heap,
+// and links that go straight on (or to a merged cell) stay in it. Cells come
+// out in the same order as from a single heap over all of them, so the depths
+// are the same as those of the heap search. The per-cell state is stamped
+// with the run it belongs to, so that one search can be reused for every
+// origin without clearing
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+#include "vgageometry.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class AngularBucketSearch {
+  public:
+    // in right angles, so the ring takes 2 / BUCKET_WIDTH buckets and a bit
+    static constexpr double BUCKET_WIDTH = 1.0 / 32;
+    static constexpr double MAX_TURN = 2.0;
+
+  private:
+    using Entry = std::pair<double, uint32_t>;
+
+    const LatticeGraphCSR &m_graph;
+    const std::vector<Point2f> &m_locations;
+    std::vector<std::vector<Entry>> m_buckets;
+    std::vector<Entry> m_current; // heap of the bucket being emptied
+    size_t m_currentBucket = 0;
+    std::vector<uint32_t> m_reachedIn; // the run that last reached / settled every cell
+    std::vector<uint32_t> m_settledIn;
+    std::vector<double> m_depth;
+    std::vector<uint32_t> m_parent;
+    uint32_t m_run = 0;
+
+    size_t getBucket(double depth) const { return static_cast<size_t>(depth / BUCKET_WIDTH); }
+    void startRun();
+    void relax(uint32_t cell, double depth, uint32_t from, size_t &queued);
+
+  public:
+    AngularBucketSearch(const LatticeGraphCSR &graph, const std::vector<Point2f> &locations);
+
+    // Settles every cell the search can get to from the sources in order of angular depth,
+    // going only through the cells within(cell) accepts, and calls settle(cell, depth) for each
+    template <typename Within, typename Settle>
+    void run(const std::vector<uint32_t> &sources, Within &&within, Settle &&settle);
+};
+
+template <typename Within, typename Settle>
+void AngularBucketSearch::run(const std::vector<uint32_t> &sources, Within &&within,
+                              Settle &&settle) {
+    startRun();
+    size_t queued = 0;
+    m_currentBucket = 0;
+    for (uint32_t source : sources) {
+        if (within(source)) {
+            relax(source, 0.0, LatticeGraphCSR::NO_CELL, queued);
+        }
+    }
+    for (; queued > 0; m_currentBucket++) {
+        auto &entries = m_buckets[m_currentBucket % m_buckets.size()];
+        // only the sources can be in the heap already
+        m_current.insert(m_current.end(), entries.begin(), entries.end());
+        entries.clear();
+        std::make_heap(m_current.begin(), m_current.end(), std::greater<Entry>());
+        while (!m_current.empty()) {
+            std::pop_heap(m_current.begin(), m_current.end(), std::greater<Entry>());
+            auto [cellDepth, cell] = m_current.back();
+            m_current.pop_back();
+            queued--;
+            if (m_settledIn[cell] == m_run) {
+                continue;
+            }
+            m_settledIn[cell] = m_run;
+            settle(cell, cellDepth);
+
+            const uint32_t parent = m_parent[cell];
+            for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell); ++it) {
+                if (m_settledIn[*it] == m_run || !within(*it)) {
+                    continue;
+                }
+                double turn = parent == LatticeGraphCSR::NO_CELL
+                                  ? 0.0
+                                  : VGAGeometry::turnAngle(m_locations[parent],
+                                                           m_locations[cell], m_locations[*it]);
+                relax(*it, cellDepth + turn, cell, queued);
+            }
+            uint32_t merge = m_graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL && m_settledIn[merge] != m_run &&
+                within(merge)) {
+                relax(merge, cellDepth, LatticeGraphCSR::NO_CELL, queued);
+            }
+        }
+    }
+}
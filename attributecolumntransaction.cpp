@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "attributecolumntransaction.hpp"
+
+#include <algorithm>
+
+AttributeColumnTransaction::~AttributeColumnTransaction() {
+    if (m_open) {
+        rollback();
+    }
+}
+
+void AttributeColumnTransaction::insertOrResetColumn(const std::string &name) {
+    m_attributes.insertOrResetColumn(getPendingName(name));
+    if (std::find(m_names.begin(), m_names.end(), name) == m_names.end()) {
+        m_names.push_back(name);
+    }
+}
+
+size_t AttributeColumnTransaction::getColumnIndex(const std::string &name) const {
+    return m_attributes.getColumnIndex(getPendingName(name));
+}
+
+void AttributeColumnTransaction::commit() {
+    if (!m_open) {
+        return;
+    }
+    m_open = false;
+    // the indices move with every removal, so they are looked up by name every time
+    for (const auto &name : m_names) {
+        if (m_attributes.hasColumn(name)) {
+            m_attributes.removeColumn(m_attributes.getColumnIndex(name));
+        }
+        m_attributes.renameColumn(m_attributes.getColumnIndex(getPendingName(name)), name);
+    }
+}
+
+void AttributeColumnTransaction::rollback() {
+    if (!m_open) {
+        return;
+    }
+    m_open = false;
+    for (const auto &name : m_names) {
+        if (m_attributes.hasColumn(getPendingName(name))) {
+            m_attributes.removeColumn(m_attributes.getColumnIndex(getPendingName(name)));
+        }
+    }
+}
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The output columns of an analysis, written straight into the attribute
+// table but only taking the place of the columns of the same names once the
+// analysis completes. Every column goes in under a pending name next to the
+// one it replaces and commit() swaps it in, by removing the old column and
+// renaming the new one. If the analysis is cancelled (or throws otherwise)
+// the transaction goes out of scope uncommitted and the pending columns are
+// removed, leaving the table as it was. Until the commit the table holds the
+// old and the new values of every column that is replaced, so this is no
+// lighter than copying a finished result in, only safe to cancel
+
+#pragma once
+
+#include "salalib/attributetable.hpp"
+
+#include <string>
+#include <vector>
+
+class AttributeColumnTransaction {
+    AttributeTable &m_attributes;
+    std::vector<std::string> m_names;
+    bool m_open = true;
+
+  public:
+    static std::string getPendingName(const std::string &name) { return name + " [Pending]"; }
+
+    explicit AttributeColumnTransaction(AttributeTable &attributes) : m_attributes(attributes) {}
+    ~AttributeColumnTransaction();
+    AttributeColumnTransaction(const AttributeColumnTransaction &) = delete;
+    AttributeColumnTransaction &operator=(const AttributeColumnTransaction &) = delete;
+
+    // inserts (or resets) the pending column that will take the name on commit
+    void insertOrResetColumn(const std::string &name);
+    // where the values of the named column are to be written until the commit. The indices
+    // change with every insert, so retrieve them after all the columns are in
+    size_t getColumnIndex(const std::string &name) const;
+
+    void commit();
+    void rollback();
+};
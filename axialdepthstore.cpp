@@ -0,0 +1,400 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "axialdepthstore.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/axialmodules/axialstepdepth.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // the file is the header, the matrix and then the overflow table
+    struct Header {
+        char magic[8];
+        uint32_t lineCount;
+        uint32_t byteOrder; // files are only read on machines of the same byte order
+        uint64_t fingerprint;
+        uint64_t overflowCount;
+    };
+    constexpr char MAGIC[8] = {'D', 'M', 'A', 'X', 'D', 'E', 'P', '1'};
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr size_t HEADER_SIZE = sizeof(Header);
+    constexpr size_t OVERFLOW_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+
+    void combine(uint64_t &hash, uint64_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+
+    // the lines as ShapeGraphCSR numbers them
+    size_t getMapLineCount(const ShapeGraph &map) {
+        return std::min(map.getAllShapes().size(), map.getConnections().size());
+    }
+} // namespace
+
+// a file mapped into memory, on the platforms that have mmap
+class AxialDepthStore::FileMapping {
+    uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+
+  public:
+    FileMapping() {}
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+    ~FileMapping();
+
+    // makes fileName size bytes long and maps it to be written
+    bool create(const std::string &fileName, size_t size);
+    // maps all of fileName to be read
+    bool open(const std::string &fileName);
+
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+#ifndef _WIN32
+AxialDepthStore::FileMapping::~FileMapping() {
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+}
+
+bool AxialDepthStore::FileMapping::create(const std::string &fileName, size_t size) {
+    int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    // the mapping holds on to the file
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<uint8_t *>(data);
+    m_size = size;
+    return true;
+}
+
+bool AxialDepthStore::FileMapping::open(const std::string &fileName) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    void *data = MAP_FAILED;
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+        m_size = static_cast<size_t>(status.st_size);
+        data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        m_size = 0;
+        return false;
+    }
+    m_data = static_cast<uint8_t *>(data);
+    return true;
+}
+#else
+// the store is read into and written from memory instead
+AxialDepthStore::FileMapping::~FileMapping() {}
+bool AxialDepthStore::FileMapping::create(const std::string &, size_t) { return false; }
+bool AxialDepthStore::FileMapping::open(const std::string &) { return false; }
+#endif
+
+AxialDepthStore::AxialDepthStore() {}
+AxialDepthStore::~AxialDepthStore() {}
+
+uint64_t AxialDepthStore::getFingerprint(const ShapeGraph &map) {
+    const size_t lineCount = getMapLineCount(map);
+    const auto &connectors = map.getConnections();
+    uint64_t hash = 0;
+    combine(hash, lineCount);
+    auto shapeIt = map.getAllShapes().begin();
+    for (size_t line = 0; line < lineCount; line++, ++shapeIt) {
+        combine(hash, static_cast<uint64_t>(shapeIt->first));
+        combine(hash, connectors[line].connections.size());
+        for (size_t other : connectors[line].connections) {
+            combine(hash, other);
+        }
+    }
+    return hash;
+}
+
+uint32_t AxialDepthStore::getLine(int ref) const {
+    auto it = std::lower_bound(m_refs.begin(), m_refs.end(), ref);
+    return it == m_refs.end() || *it != ref ? ShapeGraphCSR::NO_LINE
+                                            : static_cast<uint32_t>(it - m_refs.begin());
+}
+
+bool AxialDepthStore::build(const ShapeGraph &map, const ShapeGraphCSR &graph, Communicator *comm,
+                            size_t threadCount, const std::string &fileName) {
+    const size_t lineCount = graph.getLineCount();
+    m_depths = nullptr;
+    m_mapping.reset();
+    m_ownedDepths.clear();
+    m_overflows.clear();
+    if (map.isSegmentMap() || graph.empty() || graph.isReordered() || lineCount > MAX_LINES) {
+        return false;
+    }
+    const size_t matrixSize = lineCount * lineCount;
+
+    // straight into the file where it can be mapped, the header is written last so that a file
+    // left by a cancelled build is never opened
+    uint8_t *depths = nullptr;
+    if (!fileName.empty()) {
+        auto mapping = std::make_unique<FileMapping>();
+        if (mapping->create(fileName, HEADER_SIZE + matrixSize)) {
+            m_mapping = std::move(mapping);
+            depths = m_mapping->data() + HEADER_SIZE;
+        }
+    }
+    if (depths == nullptr) {
+        m_ownedDepths.resize(matrixSize);
+        depths = m_ownedDepths.data();
+    }
+
+    WorkStealingPool pool(threadCount);
+    std::vector<std::vector<uint32_t>> queues(pool.getThreadCount());
+    std::vector<std::vector<Overflow>> overflows(pool.getThreadCount());
+    pool.parallelFor(
+        lineCount,
+        [&](size_t origin, size_t worker) {
+            uint8_t *row = depths + origin * lineCount;
+            std::fill(row, row + lineCount, UNREACHABLE);
+            auto &queue = queues[worker];
+            queue.clear();
+            queue.push_back(static_cast<uint32_t>(origin));
+            row[origin] = 0;
+            // a level at a time, so that the depth does not have to be kept per line
+            uint32_t depth = 0;
+            for (size_t levelStart = 0; levelStart < queue.size(); depth++) {
+                const size_t levelEnd = queue.size();
+                const uint8_t stored = depth + 1 < OVERFLOW_DEPTH ? static_cast<uint8_t>(depth + 1)
+                                                                  : OVERFLOW_DEPTH;
+                for (size_t q = levelStart; q < levelEnd; q++) {
+                    for (auto it = graph.connectionsBegin(queue[q]);
+                         it != graph.connectionsEnd(queue[q]); ++it) {
+                        if (row[*it] != UNREACHABLE) {
+                            continue;
+                        }
+                        row[*it] = stored;
+                        queue.push_back(*it);
+                        if (stored == OVERFLOW_DEPTH) {
+                            overflows[worker].push_back({origin * lineCount + *it, depth + 1});
+                        }
+                    }
+                }
+                levelStart = levelEnd;
+            }
+        },
+        comm);
+
+    for (auto &workerOverflows : overflows) {
+        m_overflows.insert(m_overflows.end(), workerOverflows.begin(), workerOverflows.end());
+    }
+    std::sort(m_overflows.begin(), m_overflows.end());
+    m_refs.resize(lineCount);
+    for (uint32_t line = 0; line < lineCount; line++) {
+        m_refs[line] = graph.getRef(line);
+    }
+    m_fingerprint = getFingerprint(map);
+
+    if (!fileName.empty() && !writeFile(fileName)) {
+        m_mapping.reset();
+        m_ownedDepths.clear();
+        return false;
+    }
+    m_depths = depths;
+    return true;
+}
+
+bool AxialDepthStore::writeFile(const std::string &fileName) const {
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.lineCount = static_cast<uint32_t>(m_refs.size());
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.fingerprint = m_fingerprint;
+    header.overflowCount = m_overflows.size();
+
+    std::ofstream stream;
+    if (m_mapping) {
+        // only the overflow table is left to go after the mapped matrix
+        stream.open(fileName, std::ios::binary | std::ios::out | std::ios::app);
+    } else {
+        stream.open(fileName, std::ios::binary | std::ios::out | std::ios::trunc);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(m_ownedDepths.data()),
+                     static_cast<std::streamsize>(m_ownedDepths.size()));
+    }
+    for (const auto &overflow : m_overflows) {
+        stream.write(reinterpret_cast<const char *>(&overflow.index), sizeof(overflow.index));
+        stream.write(reinterpret_cast<const char *>(&overflow.depth), sizeof(overflow.depth));
+    }
+    stream.close();
+    if (!stream) {
+        return false;
+    }
+    if (m_mapping) {
+        std::memcpy(m_mapping->data(), &header, sizeof(header));
+    }
+    return true;
+}
+
+bool AxialDepthStore::readFile(const std::string &fileName) {
+    auto mapping = std::make_unique<FileMapping>();
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if (mapping->open(fileName)) {
+        m_mapping = std::move(mapping);
+        data = m_mapping->data();
+        size = m_mapping->size();
+    } else {
+        // all of the file in memory, with the matrix after the header as in the file
+        std::ifstream stream(fileName, std::ios::binary | std::ios::in);
+        if (!stream) {
+            return false;
+        }
+        m_ownedDepths.assign(std::istreambuf_iterator<char>(stream),
+                             std::istreambuf_iterator<char>());
+        data = m_ownedDepths.data();
+        size = m_ownedDepths.size();
+    }
+    if (size < HEADER_SIZE) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    const size_t lineCount = header.lineCount;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.byteOrder != BYTE_ORDER_MARK || lineCount != m_refs.size() ||
+        header.fingerprint != m_fingerprint) {
+        return false;
+    }
+    const size_t matrixSize = lineCount * lineCount;
+    if (size != HEADER_SIZE + matrixSize + header.overflowCount * OVERFLOW_SIZE) {
+        return false;
+    }
+    m_overflows.resize(header.overflowCount);
+    const uint8_t *entry = data + HEADER_SIZE + matrixSize;
+    for (auto &overflow : m_overflows) {
+        std::memcpy(&overflow.index, entry, sizeof(overflow.index));
+        std::memcpy(&overflow.depth, entry + sizeof(overflow.index), sizeof(overflow.depth));
+        entry += OVERFLOW_SIZE;
+    }
+    m_depths = data + HEADER_SIZE;
+    return true;
+}
+
+bool AxialDepthStore::open(const ShapeGraph &map, const std::string &fileName) {
+    m_depths = nullptr;
+    m_mapping.reset();
+    m_ownedDepths.clear();
+    m_overflows.clear();
+    if (map.isSegmentMap()) {
+        return false;
+    }
+    // the lines are as in the map, as long as the fingerprint of the file agrees
+    const size_t lineCount = getMapLineCount(map);
+    m_refs.clear();
+    auto shapeIt = map.getAllShapes().begin();
+    for (size_t line = 0; line < lineCount; line++, ++shapeIt) {
+        m_refs.push_back(shapeIt->first);
+    }
+    m_fingerprint = getFingerprint(map);
+    if (!readFile(fileName)) {
+        m_depths = nullptr;
+        m_mapping.reset();
+        m_ownedDepths.clear();
+        m_overflows.clear();
+        return false;
+    }
+    return true;
+}
+
+uint32_t AxialDepthStore::getDepth(uint32_t origin, uint32_t target) const {
+    const uint64_t index = static_cast<uint64_t>(origin) * m_refs.size() + target;
+    const uint8_t depth = m_depths[index];
+    if (depth == UNREACHABLE) {
+        return NO_DEPTH;
+    } else if (depth != OVERFLOW_DEPTH) {
+        return depth;
+    }
+    auto it = std::lower_bound(m_overflows.begin(), m_overflows.end(), Overflow{index, 0});
+    return it == m_overflows.end() || it->index != index ? NO_DEPTH : it->depth;
+}
+
+std::vector<uint32_t> AxialDepthStore::getStepDepths(const std::set<int> &originRefs) const {
+    const size_t lineCount = m_refs.size();
+    std::vector<uint32_t> origins;
+    for (int ref : originRefs) {
+        uint32_t line = getLine(ref);
+        if (line != ShapeGraphCSR::NO_LINE) {
+            origins.push_back(line);
+        }
+    }
+
+    // escaped depths are all past the others and unreachable is past everything, so the least
+    // byte is the least depth unless it is escaped
+    std::vector<uint8_t> nearest(lineCount, UNREACHABLE);
+    for (uint32_t origin : origins) {
+        const uint8_t *row = m_depths + static_cast<size_t>(origin) * lineCount;
+        for (size_t line = 0; line < lineCount; line++) {
+            nearest[line] = std::min(nearest[line], row[line]);
+        }
+    }
+
+    std::vector<uint32_t> depths(lineCount, NO_DEPTH);
+    for (size_t line = 0; line < lineCount; line++) {
+        if (nearest[line] == OVERFLOW_DEPTH) {
+            for (uint32_t origin : origins) {
+                depths[line] =
+                    std::min(depths[line], getDepth(origin, static_cast<uint32_t>(line)));
+            }
+        } else if (nearest[line] != UNREACHABLE) {
+            depths[line] = nearest[line];
+        }
+    }
+    return depths;
+}
+
+bool AxialDepthStore::writeStepDepth(ShapeGraph &map, const std::set<int> &originRefs) const {
+    if (empty()) {
+        return false;
+    }
+    const auto depths = getStepDepths(originRefs);
+
+    auto &attributes = map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(AxialStepDepth::Column::STEP_DEPTH);
+    // the column order might have changed while inserting, retrieve them all again:
+    auto stepDepthCol = transaction.getColumnIndex(AxialStepDepth::Column::STEP_DEPTH);
+
+    for (size_t line = 0; line < depths.size(); line++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_refs[line]));
+        if (row == nullptr) {
+            continue;
+        }
+        row->setValue(stepDepthCol,
+                      depths[line] == NO_DEPTH ? -1.0f : static_cast<float>(depths[line]));
+    }
+
+    transaction.commit();
+    return true;
+}
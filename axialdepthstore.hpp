@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The step depth from every line of an axial map to every other, worked out
+// once so that the step depth of any selection can be read off instead of
+// searched for. Every depth is a byte in a matrix with a row per origin, and
+// the few depths too large for a byte are escaped into a sorted table. The
+// rows of the origins are brought together with a minimum over the bytes,
+// which the compiler vectorises. The store may be kept in a file next to the
+// graph, which is mapped into memory rather than read where the platform
+// allows (and then the matrix is also written straight into it). The store
+// is only good for the connections it was made from, which are checked
+// through a fingerprint before every use
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include "salalib/genlib/comm.hpp"
+#include "salalib/shapegraph.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class AxialDepthStore {
+  public:
+    static constexpr uint8_t OVERFLOW_DEPTH = 254; // the depth is in the overflow table
+    static constexpr uint8_t UNREACHABLE = 255;
+    static constexpr uint32_t NO_DEPTH = static_cast<uint32_t>(-1);
+    // a byte for every pair of lines, so 2.5GB at the most
+    static constexpr size_t MAX_LINES = 50000;
+
+  private:
+    struct Overflow {
+        uint64_t index; // origin * lines + target
+        uint32_t depth;
+        bool operator<(const Overflow &other) const { return index < other.index; }
+    };
+    class FileMapping;
+
+    std::vector<int> m_refs; // line -> shape key, sorted as in ShapeGraphCSR
+    uint64_t m_fingerprint = 0;
+    std::vector<uint8_t> m_ownedDepths;
+    std::unique_ptr<FileMapping> m_mapping;
+    const uint8_t *m_depths = nullptr;
+    std::vector<Overflow> m_overflows;
+
+    uint32_t getLine(int ref) const;
+    bool writeFile(const std::string &fileName) const;
+    bool readFile(const std::string &fileName);
+
+  public:
+    AxialDepthStore();
+    ~AxialDepthStore();
+
+    // of the lines and their connections, as the graph of the map is made from them
+    static uint64_t getFingerprint(const ShapeGraph &map);
+
+    // Makes the depths of the graph of an axial map, sharing the origins out among threadCount
+    // threads (0 for all the hardware threads), and keeps them in fileName if given. The graph
+    // has to be in the order of the shape keys. False for segment maps, maps larger than
+    // MAX_LINES or a file that can not be written
+    bool build(const ShapeGraph &map, const ShapeGraphCSR &graph, Communicator *comm,
+               size_t threadCount = 1, const std::string &fileName = "");
+    // maps the depths in fileName, false if they were not made from the map as it is now
+    bool open(const ShapeGraph &map, const std::string &fileName);
+
+    bool empty() const { return m_depths == nullptr; }
+    bool matches(const ShapeGraph &map) const {
+        return !empty() && getFingerprint(map) == m_fingerprint;
+    }
+    size_t getLineCount() const { return m_refs.size(); }
+    uint32_t getDepth(uint32_t origin, uint32_t target) const;
+
+    // the least depth from any of the origins to every line (NO_DEPTH for those out of reach)
+    std::vector<uint32_t> getStepDepths(const std::set<int> &originRefs) const;
+    // as AxialStepDepth, into its step depth column
+    bool writeStepDepth(ShapeGraph &map, const std::set<int> &originRefs) const;
+};
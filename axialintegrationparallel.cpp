@@ -0,0 +1,311 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "axialintegrationparallel.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/axialmodules/axialintegration.hpp"
+#include "salalib/axialmodules/axiallocal.hpp"
+
+#include "salalib/genlib/comm.hpp"
+#include "salalib/genlib/pafmath.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+namespace {
+    struct Sums {
+        size_t count = 0;
+        double depth = 0.0;
+    };
+
+    // the scratch space of a worker, kept from one origin to the next
+    struct Arena {
+        std::vector<uint32_t> reachedIn; // the origin (plus one) that last reached every line
+        std::vector<uint32_t> depth;
+        std::vector<uint32_t> parent;
+        std::vector<uint32_t> queue; // in order of depth, so also the order the lines are reached
+        std::vector<size_t> reachedCounts; // per radius, the lines at the start of the queue
+        std::vector<Sums> sums;            // per radius
+        std::vector<uint32_t> below; // lines under every line of the tree of the origin
+        std::vector<uint64_t> choice; // radius * lines + line
+    };
+
+    // values per radius: integration, mean depth, node count and total depth
+    constexpr size_t VALUES_PER_RADIUS = 4;
+    // local values: control, controllability and clustering coefficient
+    constexpr size_t LOCAL_VALUES = 3;
+} // namespace
+
+bool AxialIntegrationParallel::run(Communicator *comm) {
+    if (m_radiusSet.empty() || m_graph.empty()) {
+        return false;
+    }
+    const auto lineCount = static_cast<uint32_t>(m_graph.getLineCount());
+
+    // radius n (-1) goes last, as it includes everything
+    std::vector<int> radii;
+    std::vector<uint32_t> limits;
+    for (double radius : m_radiusSet) {
+        radii.push_back(static_cast<int>(radius));
+        limits.push_back(radius < 0 ? std::numeric_limits<uint32_t>::max()
+                                    : static_cast<uint32_t>(radius));
+    }
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+        std::rotate(limits.begin(), limits.begin() + 1, limits.end());
+    }
+    // the local measures need the lines two steps away whatever the radii
+    const uint32_t maxLimit = m_local ? std::max(limits.back(), uint32_t(2)) : limits.back();
+    const size_t radiusCount = radii.size();
+
+    WorkStealingPool pool(m_threadCount);
+    std::vector<Arena> arenas(pool.getThreadCount());
+    const size_t valuesPerLine = radiusCount * VALUES_PER_RADIUS;
+    std::vector<float> values(static_cast<size_t>(lineCount) * valuesPerLine, -1.0f);
+    std::vector<float> localValues(m_local ? static_cast<size_t>(lineCount) * LOCAL_VALUES : 0,
+                                   -1.0f);
+    // node counts per radius, for normalising choice
+    std::vector<uint32_t> nodeCounts(static_cast<size_t>(lineCount) * radiusCount, 0);
+
+    // the traversal is compiled for every combination of choice and local measures, so that
+    // neither is checked on the way through the connections. There is no weighted variant, as
+    // weighted integration stays with AxialIntegration
+    auto analyse = [&](auto choiceTag, auto localTag) {
+        constexpr bool choice = decltype(choiceTag)::value;
+        constexpr bool local = decltype(localTag)::value;
+        pool.parallelFor(
+            lineCount,
+            [&](size_t index, size_t worker) {
+                auto origin = static_cast<uint32_t>(index);
+                auto &arena = arenas[worker];
+                if (arena.reachedIn.empty()) {
+                    arena.reachedIn.assign(lineCount, 0);
+                    arena.depth.resize(lineCount);
+                    arena.parent.resize(lineCount);
+                    arena.queue.reserve(lineCount);
+                    arena.reachedCounts.resize(radiusCount);
+                    arena.sums.resize(radiusCount);
+                    if constexpr (choice) {
+                        arena.below.resize(lineCount);
+                        arena.choice.assign(radiusCount * lineCount, 0);
+                    }
+                }
+                const uint32_t stamp = origin + 1;
+
+                // breadth first out to the largest radius, with the first parent to get to a line
+                arena.queue.clear();
+                arena.queue.push_back(origin);
+                arena.reachedIn[origin] = stamp;
+                arena.depth[origin] = 0;
+                arena.parent[origin] = ShapeGraphCSR::NO_LINE;
+                // links between the lines next to the origin, each counted from both ends
+                size_t neighbourLinks = 0;
+                for (size_t head = 0; head < arena.queue.size(); head++) {
+                    uint32_t line = arena.queue[head];
+                    uint32_t depth = arena.depth[line];
+                    if (depth >= maxLimit) {
+                        continue;
+                    }
+                    for (auto it = m_graph.connectionsBegin(line);
+                         it != m_graph.connectionsEnd(line); ++it) {
+                        if (arena.reachedIn[*it] != stamp) {
+                            arena.reachedIn[*it] = stamp;
+                            arena.depth[*it] = depth + 1;
+                            arena.parent[*it] = line;
+                            arena.queue.push_back(*it);
+                        } else if constexpr (local) {
+                            // all the lines next to the origin are in before any of them is
+                            // expanded
+                            if (depth == 1 && arena.depth[*it] == 1) {
+                                neighbourLinks++;
+                            }
+                        }
+                    }
+                }
+
+                if constexpr (local) {
+                    float *lineLocal = &localValues[index * LOCAL_VALUES];
+                    const uint32_t connectivity = m_graph.getConnectivity(origin);
+                    double control = 0.0;
+                    size_t withinTwo = 0;
+                    for (size_t q = 1; q < arena.queue.size() && arena.depth[arena.queue[q]] <= 2;
+                         q++) {
+                        uint32_t line = arena.queue[q];
+                        if (arena.depth[line] == 1 && m_graph.getConnectivity(line) > 0) {
+                            control += 1.0 / static_cast<double>(m_graph.getConnectivity(line));
+                        }
+                        withinTwo++;
+                    }
+                    if (connectivity > 0) {
+                        lineLocal[0] = static_cast<float>(control);
+                        lineLocal[1] = static_cast<float>(static_cast<double>(connectivity) /
+                                                          static_cast<double>(withinTwo));
+                    }
+                    if (connectivity > 1) {
+                        lineLocal[2] = static_cast<float>(
+                            static_cast<double>(neighbourLinks) /
+                            (static_cast<double>(connectivity) * (connectivity - 1)));
+                    }
+                }
+
+                // the lines of every radius are the start of the queue, up to the first one deeper
+                auto &reachedCounts = arena.reachedCounts;
+                auto &sums = arena.sums;
+                {
+                    size_t r = 0;
+                    Sums total;
+                    for (size_t q = 0; q <= arena.queue.size(); q++) {
+                        while (r < radiusCount && (q == arena.queue.size() ||
+                                                   arena.depth[arena.queue[q]] > limits[r])) {
+                            reachedCounts[r] = q;
+                            sums[r] = total;
+                            r++;
+                        }
+                        if (q < arena.queue.size()) {
+                            total.count++;
+                            total.depth += arena.depth[arena.queue[q]];
+                        }
+                    }
+                }
+
+                float *lineValues = &values[index * valuesPerLine];
+                for (size_t r = 0; r < radiusCount; r++) {
+                    // the origin is one of the nodes, at depth 0
+                    const size_t nodeCount = sums[r].count;
+                    const double totalDepth = sums[r].depth;
+                    float *radiusValues = &lineValues[r * VALUES_PER_RADIUS];
+                    if (nodeCount > 1) {
+                        double meanDepth = totalDepth / static_cast<double>(nodeCount - 1);
+                        if (nodeCount > 2 && meanDepth > 1.0) {
+                            double ra =
+                                2.0 * (meanDepth - 1.0) / static_cast<double>(nodeCount - 2);
+                            double rraD = ra / pafmath::dvalue(static_cast<double>(nodeCount));
+                            radiusValues[0] = static_cast<float>(1.0 / rraD);
+                        }
+                        radiusValues[1] = static_cast<float>(meanDepth);
+                    }
+                    radiusValues[2] = static_cast<float>(nodeCount);
+                    radiusValues[3] = static_cast<float>(totalDepth);
+                    nodeCounts[index * radiusCount + r] = static_cast<uint32_t>(nodeCount);
+                }
+
+                if constexpr (!choice) {
+                    return;
+                }
+                // every line deeper in the tree is a path through this one from the origin, so the
+                // choice of a line goes up by the lines under it, from the bottom of the tree up
+                for (size_t r = 0; r < radiusCount; r++) {
+                    uint64_t *radiusChoice = &arena.choice[r * lineCount];
+                    for (size_t q = 0; q < reachedCounts[r]; q++) {
+                        arena.below[arena.queue[q]] = 0;
+                    }
+                    for (size_t q = reachedCounts[r]; q-- > 1;) {
+                        uint32_t line = arena.queue[q];
+                        radiusChoice[line] += arena.below[line];
+                        arena.below[arena.parent[line]] += arena.below[line] + 1;
+                    }
+                }
+            },
+            comm);
+    };
+    if (m_choice && m_local) {
+        analyse(std::true_type(), std::true_type());
+    } else if (m_choice) {
+        analyse(std::true_type(), std::false_type());
+    } else if (m_local) {
+        analyse(std::false_type(), std::true_type());
+    } else {
+        analyse(std::false_type(), std::false_type());
+    }
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    using Column = AxialIntegration::Column;
+    using Normalisation = AxialIntegration::Normalisation;
+    auto getColumnNames = [](int radius) {
+        return std::vector<std::string>{
+            AxialIntegration::getFormattedColumn(Column::INTEGRATION, radius, std::nullopt,
+                                                 Normalisation::HH),
+            AxialIntegration::getFormattedColumn(Column::MEAN_DEPTH, radius),
+            AxialIntegration::getFormattedColumn(Column::NODE_COUNT, radius),
+            AxialIntegration::getFormattedColumn(Column::TOTAL_DEPTH, radius)};
+    };
+    auto getChoiceNames = [](int radius) {
+        return std::vector<std::string>{
+            AxialIntegration::getFormattedColumn(Column::CHOICE, radius),
+            AxialIntegration::getFormattedColumn(Column::CHOICE_NORM, radius)};
+    };
+    std::vector<std::string> localNames;
+    if (m_local) {
+        localNames = {AxialLocal::Column::CONTROL, AxialLocal::Column::CONTROLLABILITY,
+                      AxialLocal::Column::CLUSTERING_COEFFICIENT};
+    }
+    for (const auto &name : localNames) {
+        transaction.insertOrResetColumn(name);
+    }
+    for (int radius : radii) {
+        for (const auto &name : getColumnNames(radius)) {
+            transaction.insertOrResetColumn(name);
+        }
+        if (m_choice) {
+            for (const auto &name : getChoiceNames(radius)) {
+                transaction.insertOrResetColumn(name);
+            }
+        }
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> cols, choiceCols, localCols;
+    for (int radius : radii) {
+        for (const auto &name : getColumnNames(radius)) {
+            cols.push_back(transaction.getColumnIndex(name));
+        }
+        if (m_choice) {
+            for (const auto &name : getChoiceNames(radius)) {
+                choiceCols.push_back(transaction.getColumnIndex(name));
+            }
+        }
+    }
+    for (const auto &name : localNames) {
+        localCols.push_back(transaction.getColumnIndex(name));
+    }
+
+    for (uint32_t line = 0; line < lineCount; line++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(line)));
+        if (row == nullptr) {
+            continue;
+        }
+        for (size_t v = 0; v < valuesPerLine; v++) {
+            row->setValue(cols[v], values[line * valuesPerLine + v]);
+        }
+        for (size_t v = 0; v < localCols.size(); v++) {
+            row->setValue(localCols[v], localValues[line * LOCAL_VALUES + v]);
+        }
+        if (!m_choice) {
+            continue;
+        }
+        for (size_t r = 0; r < radiusCount; r++) {
+            // whole counts, so the sum is the same in any order
+            uint64_t choice = 0;
+            for (const auto &arena : arenas) {
+                if (!arena.choice.empty()) {
+                    choice += arena.choice[r * lineCount + line];
+                }
+            }
+            // every ordered pair of lines is a path, so out of (n - 1)(n - 2) at most
+            double nodeCount = nodeCounts[line * radiusCount + r];
+            row->setValue(choiceCols[r * 2], static_cast<float>(choice));
+            row->setValue(choiceCols[r * 2 + 1],
+                          nodeCount > 2 ? static_cast<float>(static_cast<double>(choice) /
+                                                             ((nodeCount - 1) * (nodeCount - 2)))
+                                        : -1.0f);
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
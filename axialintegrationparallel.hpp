@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Axial integration (and choice) with the origin lines shared out among
+// threads. Every worker keeps an arena of depths, parents and a queue that it
+// reuses from one origin to the next. The per-origin measures go to a buffer
+// slot of their own and the choice counts of every worker are added up in
+// worker order, so the table comes out the same whatever the number of
+// threads. Gives the integration, mean depth, node count, total depth and
+// choice columns of AxialIntegration, without weights. The local measures of
+// AxialLocal can come out of the same traversal, as the lines one and two
+// steps away are the first it reaches
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include "salalib/shapegraph.hpp"
+
+#include <set>
+
+class AxialIntegrationParallel {
+    ShapeGraph &m_map;
+    const ShapeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // in steps, -1 for radius n
+    bool m_choice;
+    bool m_local;
+    size_t m_threadCount;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    AxialIntegrationParallel(ShapeGraph &map, const ShapeGraphCSR &graph,
+                             std::set<double> radiusSet, bool choice, bool local = false,
+                             size_t threadCount = 0)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)), m_choice(choice),
+          m_local(local), m_threadCount(threadCount) {}
+    std::string getAnalysisName() const { return "Axial Integration (Parallel)"; }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,280 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "bitmapfrontierbfs.hpp"
+
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define BITMAPFRONTIER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    int lowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int bit = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    uint64_t popcount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<uint64_t>(__builtin_popcountll(bits));
+#else
+        uint64_t count = 0;
+        for (; bits; bits &= bits - 1) {
+            count++;
+        }
+        return count;
+#endif
+    }
+
+    // whether any of the cells from it to end is in the frontier
+    bool anyInFrontierScalar(const uint32_t *it, const uint32_t *end, const uint64_t *frontier) {
+        for (; it != end; ++it) {
+            if ((frontier[*it >> 6] >> (*it & 63)) & 1) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // frontier = next, visited |= next, next = 0, returns the number of cells in the new frontier
+    uint64_t commitScalar(uint64_t *visited, uint64_t *frontier, uint64_t *next, size_t words) {
+        uint64_t count = 0;
+        for (size_t w = 0; w < words; w++) {
+            frontier[w] = next[w];
+            visited[w] |= next[w];
+            count += popcount(next[w]);
+            next[w] = 0;
+        }
+        return count;
+    }
+
+#ifdef BITMAPFRONTIER_X86
+    __attribute__((target("sse4.2,popcnt"))) uint64_t commitSSE42(uint64_t *visited,
+                                                                   uint64_t *frontier,
+                                                                   uint64_t *next, size_t words) {
+        uint64_t count = 0;
+        size_t w = 0;
+        for (; w + 2 <= words; w += 2) {
+            __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i *>(next + w));
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(visited + w));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(frontier + w), n);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(visited + w), _mm_or_si128(v, n));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(next + w), _mm_setzero_si128());
+            count += static_cast<uint64_t>(_mm_popcnt_u64(
+                         static_cast<unsigned long long>(_mm_cvtsi128_si64(n)))) +
+                     static_cast<uint64_t>(_mm_popcnt_u64(
+                         static_cast<unsigned long long>(_mm_extract_epi64(n, 1))));
+        }
+        return count + commitScalar(visited + w, frontier + w, next + w, words - w);
+    }
+
+    __attribute__((target("avx2,popcnt"))) uint64_t commitAVX2(uint64_t *visited,
+                                                                uint64_t *frontier,
+                                                                uint64_t *next, size_t words) {
+        uint64_t count = 0;
+        size_t w = 0;
+        for (; w + 4 <= words; w += 4) {
+            __m256i n = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(next + w));
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(visited + w));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(frontier + w), n);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(visited + w), _mm256_or_si256(v, n));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(next + w), _mm256_setzero_si256());
+            if (!_mm256_testz_si256(n, n)) {
+                for (size_t lane = 0; lane < 4; lane++) {
+                    count += static_cast<uint64_t>(_mm_popcnt_u64(frontier[w + lane]));
+                }
+            }
+        }
+        return count + commitScalar(visited + w, frontier + w, next + w, words - w);
+    }
+
+    // eight neighbours at a time: gather the 32-bit frontier words that hold their bits and test
+    // the bits all together
+    __attribute__((target("avx2"))) bool anyInFrontierAVX2(const uint32_t *it,
+                                                           const uint32_t *end,
+                                                           const uint64_t *frontier) {
+        const auto *frontierWords = reinterpret_cast<const int *>(frontier);
+        const __m256i lowBits = _mm256_set1_epi32(31);
+        const __m256i one = _mm256_set1_epi32(1);
+        for (; end - it >= 8; it += 8) {
+            __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it));
+            __m256i words = _mm256_i32gather_epi32(frontierWords, _mm256_srli_epi32(cells, 5), 4);
+            __m256i bits = _mm256_and_si256(
+                _mm256_srlv_epi32(words, _mm256_and_si256(cells, lowBits)), one);
+            if (!_mm256_testz_si256(bits, bits)) {
+                return true;
+            }
+        }
+        return anyInFrontierScalar(it, end, frontier);
+    }
+#endif
+} // namespace
+
+BitmapFrontierBFS::Kernel BitmapFrontierBFS::detectKernel() {
+#ifdef BITMAPFRONTIER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return Kernel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+        return Kernel::SSE42;
+    }
+#endif
+    return Kernel::SCALAR;
+}
+
+const char *BitmapFrontierBFS::getKernelName(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::AUTO:
+        return "Auto";
+    case Kernel::SCALAR:
+        return "Scalar";
+    case Kernel::SSE42:
+        return "SSE4.2";
+    case Kernel::AVX2:
+        return "AVX2";
+    }
+    return "";
+}
+
+BitmapFrontierBFS::BitmapFrontierBFS(const LatticeGraphCSR &graph, Kernel kernel)
+    : m_graph(graph), m_kernel(kernel), m_words((graph.getCellCount() + 63) / 64),
+      m_totalLinks(graph.getLinkCount()), m_visited(m_words), m_frontier(m_words),
+      m_next(m_words) {
+    // never ask for more than the processor has
+    Kernel supported = detectKernel();
+    if (m_kernel == Kernel::AUTO || m_kernel > supported) {
+        m_kernel = supported;
+    }
+    for (uint32_t cell = 0; cell < graph.getCellCount(); cell++) {
+        if (graph.getMerge(cell) != LatticeGraphCSR::NO_CELL) {
+            m_mergedCells.push_back(cell);
+        }
+    }
+}
+
+void BitmapFrontierBFS::run(const std::vector<uint32_t> &sources, size_t maxDepth,
+                            std::vector<size_t> &distribution, std::vector<int> *depths) {
+    const size_t cellCount = m_graph.getCellCount();
+    distribution.clear();
+    if (depths) {
+        depths->assign(cellCount, -1);
+    }
+    if (cellCount == 0) {
+        return;
+    }
+
+    std::fill(m_visited.begin(), m_visited.end(), 0);
+    std::fill(m_frontier.begin(), m_frontier.end(), 0);
+    std::fill(m_next.begin(), m_next.end(), 0);
+    // the padding after the last cell counts as visited so that it is never picked up
+    if (cellCount % 64 != 0) {
+        m_visited.back() = ~uint64_t(0) << (cellCount % 64);
+    }
+
+    for (uint32_t source : sources) {
+        setInBitmap(m_next, source);
+    }
+
+    uint64_t visitedLinks = 0;
+    bool bottomUp = false;
+    for (size_t level = 0;; level++) {
+        // merged cells are at the same depth as their partners
+        for (uint32_t cell : m_mergedCells) {
+            if (inBitmap(m_next, cell)) {
+                uint32_t merge = m_graph.getMerge(cell);
+                if (!inBitmap(m_visited, merge)) {
+                    setInBitmap(m_next, merge);
+                }
+            }
+        }
+        uint64_t count = commitLevel();
+        if (count == 0) {
+            break;
+        }
+        distribution.push_back(count);
+
+        uint64_t frontierLinks = 0;
+        for (size_t w = 0; w < m_words; w++) {
+            for (uint64_t bits = m_frontier[w]; bits; bits &= bits - 1) {
+                auto cell = static_cast<uint32_t>(w * 64 + static_cast<size_t>(lowestBit(bits)));
+                frontierLinks += m_graph.getConnectivity(cell);
+                if (depths) {
+                    (*depths)[cell] = static_cast<int>(level);
+                }
+            }
+        }
+        visitedLinks += frontierLinks;
+
+        if (level >= maxDepth) {
+            break;
+        }
+        if (bottomUp) {
+            bottomUp = count * BETA >= cellCount;
+        } else {
+            bottomUp = frontierLinks * ALPHA > m_totalLinks - visitedLinks;
+        }
+        if (bottomUp) {
+            expandBottomUp();
+        } else {
+            expandTopDown();
+        }
+    }
+}
+
+void BitmapFrontierBFS::expandTopDown() {
+    for (size_t w = 0; w < m_words; w++) {
+        for (uint64_t bits = m_frontier[w]; bits; bits &= bits - 1) {
+            auto cell = static_cast<uint32_t>(w * 64 + static_cast<size_t>(lowestBit(bits)));
+            for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell); ++it) {
+                if (!inBitmap(m_visited, *it)) {
+                    setInBitmap(m_next, *it);
+                }
+            }
+        }
+    }
+}
+
+// visibility is symmetric, so a cell is next if any of its own neighbours is in the frontier
+void BitmapFrontierBFS::expandBottomUp() {
+    auto anyInFrontier = anyInFrontierScalar;
+#ifdef BITMAPFRONTIER_X86
+    if (m_kernel == Kernel::AVX2) {
+        anyInFrontier = anyInFrontierAVX2;
+    }
+#endif
+    const uint64_t *frontier = m_frontier.data();
+    for (size_t w = 0; w < m_words; w++) {
+        for (uint64_t bits = ~m_visited[w]; bits; bits &= bits - 1) {
+            int bit = lowestBit(bits);
+            auto cell = static_cast<uint32_t>(w * 64 + static_cast<size_t>(bit));
+            if (anyInFrontier(m_graph.neighboursBegin(cell), m_graph.neighboursEnd(cell),
+                              frontier)) {
+                m_next[w] |= uint64_t(1) << bit;
+            }
+        }
+    }
+}
+
+uint64_t BitmapFrontierBFS::commitLevel() {
+#ifdef BITMAPFRONTIER_X86
+    if (m_kernel == Kernel::AVX2) {
+        return commitAVX2(m_visited.data(), m_frontier.data(), m_next.data(), m_words);
+    }
+    if (m_kernel == Kernel::SSE42) {
+        return commitSSE42(m_visited.data(), m_frontier.data(), m_next.data(), m_words);
+    }
+#endif
+    return commitScalar(m_visited.data(), m_frontier.data(), m_next.data(), m_words);
+}
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Breadth-first search over a LatticeGraphCSR with the visited set and the
+// frontiers kept as bitmaps. Every level is expanded either top-down (the
+// frontier marks its neighbours) or bottom-up (every unvisited cell looks for
+// a neighbour in the frontier), whichever is expected to touch fewer links.
+// The bitmap loops run on AVX2 or SSE4.2 when the processor has them
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class BitmapFrontierBFS {
+  public:
+    enum class Kernel { AUTO, SCALAR, SSE42, AVX2 };
+    // the best kernel the running processor supports
+    static Kernel detectKernel();
+    static const char *getKernelName(Kernel kernel);
+
+    // direction switching thresholds: go bottom-up when the frontier has more than 1/alpha of
+    // the unvisited links, go back top-down when it has less than 1/beta of the cells
+    static constexpr uint64_t ALPHA = 14;
+    static constexpr uint64_t BETA = 24;
+
+  private:
+    const LatticeGraphCSR &m_graph;
+    Kernel m_kernel;
+    size_t m_words;
+    uint64_t m_totalLinks;
+    std::vector<uint64_t> m_visited;
+    std::vector<uint64_t> m_frontier;
+    std::vector<uint64_t> m_next;
+    std::vector<uint32_t> m_mergedCells; // cells with a merge partner
+
+  public:
+    BitmapFrontierBFS(const LatticeGraphCSR &graph, Kernel kernel = Kernel::AUTO);
+    Kernel getKernel() const { return m_kernel; }
+
+    // Walks out from the sources for up to maxDepth levels (static_cast<size_t>(-1) for all).
+    // The number of cells at every level goes to distribution and, if given, the level of every
+    // cell goes to depths (-1 for cells not reached)
+    void run(const std::vector<uint32_t> &sources, size_t maxDepth,
+             std::vector<size_t> &distribution, std::vector<int> *depths = nullptr);
+
+  private:
+    bool inBitmap(const std::vector<uint64_t> &bitmap, uint32_t cell) const {
+        return (bitmap[cell >> 6] >> (cell & 63)) & 1;
+    }
+    void setInBitmap(std::vector<uint64_t> &bitmap, uint32_t cell) {
+        bitmap[cell >> 6] |= uint64_t(1) << (cell & 63);
+    }
+    void expandTopDown();
+    void expandBottomUp();
+    uint64_t commitLevel();
+};
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "latticegraphcsr.hpp"
+
+LatticeGraphCSR::LatticeGraphCSR(LatticeMap &map)
+    : m_rows(map.getRows()), m_cols(map.getCols()), m_cellLookup(m_rows * m_cols, NO_CELL) {
+
+    // number the cells in the same column-major order the analyses use
+    for (size_t i = 0; i < m_cols; i++) {
+        for (size_t j = 0; j < m_rows; j++) {
+            PixelRef curs(static_cast<short>(i), static_cast<short>(j));
+            const Point &point = map.getPoint(curs);
+            if (point.filled() && point.hasNode()) {
+                m_cellLookup[i * m_rows + j] = static_cast<uint32_t>(m_refs.size());
+                m_refs.push_back(curs);
+            }
+        }
+    }
+
+    m_offsets.reserve(m_refs.size() + 1);
+    m_merges.reserve(m_refs.size());
+    m_offsets.push_back(0);
+    PixelRefVector hood;
+    for (uint32_t cell = 0; cell < m_refs.size(); cell++) {
+        Point &point = map.getPoint(m_refs[cell]);
+        hood.clear();
+        point.getNode().contents(hood);
+        for (const PixelRef &pix : hood) {
+            uint32_t other = getCell(pix);
+            if (other != NO_CELL && other != cell) {
+                m_neighbours.push_back(other);
+            }
+        }
+        m_offsets.push_back(static_cast<uint32_t>(m_neighbours.size()));
+        PixelRef merge = point.getMergePixel();
+        m_merges.push_back(merge == NoPixel ? NO_CELL : getCell(merge));
+    }
+    // the graph is not changed after this, so do not keep the growth slack around
+    m_neighbours.shrink_to_fit();
+}
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// A flat copy of the visibility graph of a processed LatticeMap. The cells
+// with a node are numbered densely and their neighbours are kept in
+// compressed sparse rows, so that an analysis can walk the graph without
+// going through the bins of every point
+
+#pragma once
+
+#include "salalib/latticemap.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class LatticeGraphCSR {
+  public:
+    static constexpr uint32_t NO_CELL = static_cast<uint32_t>(-1);
+
+  private:
+    size_t m_rows = 0;
+    size_t m_cols = 0;
+    std::vector<PixelRef> m_refs;       // cell -> pixel
+    std::vector<uint32_t> m_cellLookup; // pixel -> cell, indexed as x * rows + y
+    std::vector<uint32_t> m_offsets;    // cell -> first neighbour (one past the end for the last)
+    std::vector<uint32_t> m_neighbours;
+    std::vector<uint32_t> m_merges; // cell -> merged cell or NO_CELL
+
+  public:
+    LatticeGraphCSR() {}
+    LatticeGraphCSR(LatticeMap &map);
+
+    bool empty() const { return m_refs.empty(); }
+    size_t getCellCount() const { return m_refs.size(); }
+    size_t getLinkCount() const { return m_neighbours.size(); }
+    size_t getByteSize() const {
+        return m_refs.size() * sizeof(PixelRef) +
+               (m_cellLookup.size() + m_offsets.size() + m_neighbours.size() + m_merges.size()) *
+                   sizeof(uint32_t);
+    }
+
+    const PixelRef &getRef(uint32_t cell) const { return m_refs[cell]; }
+    uint32_t getCell(const PixelRef &ref) const {
+        if (ref.x < 0 || ref.y < 0 || static_cast<size_t>(ref.x) >= m_cols ||
+            static_cast<size_t>(ref.y) >= m_rows) {
+            return NO_CELL;
+        }
+        return m_cellLookup[static_cast<size_t>(ref.x) * m_rows + static_cast<size_t>(ref.y)];
+    }
+
+    uint32_t getConnectivity(uint32_t cell) const {
+        return m_offsets[cell + 1] - m_offsets[cell];
+    }
+    const uint32_t *neighboursBegin(uint32_t cell) const {
+        return m_neighbours.data() + m_offsets[cell];
+    }
+    const uint32_t *neighboursEnd(uint32_t cell) const {
+        return m_neighbours.data() + m_offsets[cell + 1];
+    }
+    uint32_t getMerge(uint32_t cell) const { return m_merges[cell]; }
+};
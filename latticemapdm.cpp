@@ -6,6 +6,22 @@
 
 #include "latticemapdm.hpp"
 
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    void combine(uint64_t &hash, uint64_t value) {
+        // as boost::hash_combine, widened to 64 bits
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 12) + (hash >> 4);
+    }
+
+    uint64_t getBits(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+} // namespace
+
 void LatticeMapDM::setDisplayedAttribute(int col) {
     if (m_displayedAttribute == col) {
         if (getInternalMap().getAttributeTableHandle().getDisplayColIndex() !=
@@ -38,6 +54,8 @@ bool LatticeMapDM::read(std::istream &stream) {
     stream.read(reinterpret_cast<char *>(&displayedAttribute), sizeof(displayedAttribute));
 
     read = read && getInternalMap().readPointsAndAttributes(stream);
+    // made again from the loaded graph when first needed
+    resetIncrementalState();
 
     m_selection = NO_SELECTION;
     m_pinnedSelection = false;
@@ -68,9 +86,11 @@ bool LatticeMapDM::undoPoints() {
     if (!m_undocounter) {
         return false;
     }
+    markEdited();
     for (auto &p : getInternalMap().getPoints()) {
         auto &ucount = m_pointUndoCounter[getInternalMap().pixelate(p.getLocation())];
         if (ucount == m_undocounter) {
+            markDirty(getInternalMap().pixelate(p.getLocation()));
             if (p.getState() & Point::FILLED) {
                 getInternalMap().setPointState(p, p.getState() & ~Point::FILLED);
                 getInternalMap().setPointState(p, p.getState() | Point::EMPTY);
@@ -89,8 +109,87 @@ bool LatticeMapDM::undoPoints() {
     return true;
 }
 
+void LatticeMapDM::makeGraphSnapshot() {
+    if (!getInternalMap().isProcessed()) {
+        m_graphSnapshot.reset();
+        return;
+    }
+    m_graphSnapshot = std::make_shared<const LatticeGraphCSR>(getInternalMap());
+}
+
+std::shared_ptr<const LatticeGraphCSR> LatticeMapDM::getGraphSnapshot() {
+    if (!m_graphSnapshot) {
+        makeGraphSnapshot();
+    }
+    return m_graphSnapshot;
+}
+
+LatticeMapDM::CatchmentSearch *LatticeMapDM::getCatchmentSearch() {
+    auto graph = getGraphSnapshot();
+    if (!graph) {
+        m_catchmentSearch.reset();
+        return nullptr;
+    }
+    // the snapshot is made again after every edit, and the one the search holds on to cannot be
+    // replaced by another at the same address
+    if (!m_catchmentSearch || m_catchmentSearch->graph != graph) {
+        auto catchmentSearch = std::make_unique<CatchmentSearch>();
+        catchmentSearch->graph = graph;
+        catchmentSearch->locations = VGAGeometry::getCellLocations(getInternalMap(), *graph);
+        catchmentSearch->search = std::make_unique<MetricBucketSearch>(
+            *graph, catchmentSearch->locations,
+            MetricBucketSearch::getLinkLengths(*graph, catchmentSearch->locations));
+        m_catchmentSearch = std::move(catchmentSearch);
+    }
+    return m_catchmentSearch.get();
+}
+
+void LatticeMapDM::markEdited() {
+    // the table may lose the values along with the graph, keep them while they are still there
+    if (m_incrementalState) {
+        m_incrementalState->captureValues(getInternalMap().getAttributeTable());
+    }
+    clearGraphSnapshot();
+}
+
+void LatticeMapDM::markDirty(const PixelRef &pix) {
+    if (m_dirtyBl == NoPixel) {
+        m_dirtyBl = pix;
+        m_dirtyTr = pix;
+        return;
+    }
+    m_dirtyBl.x = std::min(m_dirtyBl.x, pix.x);
+    m_dirtyBl.y = std::min(m_dirtyBl.y, pix.y);
+    m_dirtyTr.x = std::max(m_dirtyTr.x, pix.x);
+    m_dirtyTr.y = std::max(m_dirtyTr.y, pix.y);
+}
+
+void LatticeMapDM::markAllDirty() {
+    m_dirtyBl = PixelRef(0, 0);
+    m_dirtyTr = PixelRef(static_cast<short>(getInternalMap().getCols() - 1),
+                         static_cast<short>(getInternalMap().getRows() - 1));
+}
+
+void LatticeMapDM::markGraphInputs(const std::vector<Line4f> &lines, bool boundaryGraph,
+                                   double maxDist) {
+    uint64_t inputs = 0;
+    combine(inputs, lines.size());
+    for (const auto &line : lines) {
+        for (double value : {line.start().x, line.start().y, line.end().x, line.end().y}) {
+            combine(inputs, getBits(value));
+        }
+    }
+    combine(inputs, boundaryGraph);
+    combine(inputs, getBits(maxDist));
+    if (inputs != m_graphInputs) {
+        m_graphInputs = inputs;
+        markAllDirty();
+    }
+}
+
 void LatticeMapDM::copy(const LatticeMapDM &sourcemap, bool copypoints, bool copyattributes) {
     getInternalMap().copy(sourcemap.getInternalMap(), copypoints, copyattributes);
+    resetIncrementalState();
 
     m_undocounter = sourcemap.m_undocounter;
 
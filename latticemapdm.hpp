@@ -9,9 +9,14 @@
 #pragma once
 
 #include "attributemapdm.hpp"
+#include "latticegraphcsr.hpp"
+#include "metricbucketsearch.hpp"
+#include "vgaincrementalstate.hpp"
 
 #include "salalib/latticemap.hpp"
 
+#include <memory>
+
 class LatticeMapDM : public AttributeMapDM {
 
     enum {
@@ -45,6 +50,30 @@ class LatticeMapDM : public AttributeMapDM {
     mutable PixelRef m_prc; // cursor for point lines
     mutable PixelRef m_tr;
 
+    // frozen copy of the visibility graph, shared by the analyses run on this map. It is made
+    // when the graph is made (or on first use after loading) and dropped whenever the points or
+    // their connections change
+    std::shared_ptr<const LatticeGraphCSR> m_graphSnapshot;
+
+  public:
+    // the search the catchments go over, with the locations of the cells it was made with, for as
+    // long as the snapshot it was made from is the one on the map
+    struct CatchmentSearch {
+        std::shared_ptr<const LatticeGraphCSR> graph;
+        std::vector<Point2f> locations;
+        std::unique_ptr<MetricBucketSearch> search;
+    };
+
+  private:
+    std::unique_ptr<CatchmentSearch> m_catchmentSearch;
+
+    // bounds of the pixels edited since the last analysis, and what that analysis was run on
+    PixelRef m_dirtyBl = NoPixel;
+    PixelRef m_dirtyTr = NoPixel;
+    // of the walls and settings the graph was last made with, which change the links anywhere
+    uint64_t m_graphInputs = 0;
+    std::unique_ptr<VGAIncrementalState> m_incrementalState;
+
   protected:
     // which attribute is currently displayed:
     mutable int m_displayedAttribute;
@@ -111,6 +140,42 @@ class LatticeMapDM : public AttributeMapDM {
                                                          m_selectionSet));
     }
 
+    // the graph snapshot is only valid for a processed map
+    bool hasGraphSnapshot() const { return m_graphSnapshot != nullptr; }
+    void makeGraphSnapshot();
+    void clearGraphSnapshot() {
+        m_graphSnapshot.reset();
+        m_catchmentSearch.reset();
+    }
+    std::shared_ptr<const LatticeGraphCSR> getGraphSnapshot();
+    // null for a map that has not been processed
+    CatchmentSearch *getCatchmentSearch();
+
+    // the points or their connections are about to change: keeps the values of the last
+    // analysis and drops the graph snapshot
+    void markEdited();
+    void markDirty(const PixelRef &pix);
+    void markAllDirty();
+    // the graph is about to be made from these, everything is dirty if they are not the same as
+    // the last time
+    void markGraphInputs(const std::vector<Line4f> &lines, bool boundaryGraph, double maxDist);
+    bool hasDirtyRegion() const { return m_dirtyBl != NoPixel; }
+    std::pair<PixelRef, PixelRef> getDirtyRegion() const { return {m_dirtyBl, m_dirtyTr}; }
+    void clearDirtyRegion() {
+        m_dirtyBl = NoPixel;
+        m_dirtyTr = NoPixel;
+    }
+    VGAIncrementalState *getIncrementalState() { return m_incrementalState.get(); }
+    void setIncrementalState(std::unique_ptr<VGAIncrementalState> &&state) {
+        m_incrementalState = std::move(state);
+    }
+    // for changes after which nothing of the previous analysis can be reused
+    void resetIncrementalState() {
+        m_incrementalState.reset();
+        clearDirtyRegion();
+        clearGraphSnapshot();
+    }
+
     bool undoPoints();
     bool canUndo() const { return !getInternalMap().isProcessed() && m_undocounter != 0; }
 
@@ -119,6 +184,7 @@ class LatticeMapDM : public AttributeMapDM {
     void copy(const LatticeMapDM &sourcemap, bool copypoints, bool copyattributes);
 
     bool setGrid(double spacing, const Point2f &offset) {
+        resetIncrementalState();
         auto result = getInternalMap().setGrid(spacing, offset);
         m_undocounter = 0; // <- reset the undo counter... sorry... once you've done
                            // this you can't undo
@@ -153,8 +219,10 @@ class LatticeMapDM : public AttributeMapDM {
     }
 
     bool clearPoints() {
+        markEdited();
         bool result = false;
         if (m_selection == NO_SELECTION) {
+            markAllDirty();
 
             for (auto &point : getInternalMap().getPoints()) {
                 m_pointUndoCounter[getInternalMap().pixelate(point.getLocation())] = m_undocounter;
@@ -164,6 +232,9 @@ class LatticeMapDM : public AttributeMapDM {
             if (!getInternalMap().getFilledPointCount()) {
                 return false;
             }
+            for (auto sel : m_selectionSet) {
+                markDirty(sel);
+            }
             m_undocounter++;
 
             m_undocounter++;
@@ -179,6 +250,9 @@ class LatticeMapDM : public AttributeMapDM {
             }
             result = getInternalMap().clearPointsInRange(m_sBl, m_sTr, m_selectionSet);
         } else { // COMPOUND_SELECTION (note, need to test bitwise now)
+            for (auto sel : m_selectionSet) {
+                markDirty(sel);
+            }
             result = getInternalMap().clearPointsInRange(
                 PixelRef(0, 0),
                 PixelRef(static_cast<short>(getInternalMap().getRows()),
@@ -228,6 +302,11 @@ class LatticeMapDM : public AttributeMapDM {
         if (!m_selectionSet.size()) {
             return false;
         }
+        markEdited();
+        markDirty(getInternalMap().pixelate(p));
+        for (auto sel : m_selectionSet) {
+            markDirty(sel);
+        }
         auto pointsMerged = getInternalMap().mergePoints(p, m_selBounds, m_selectionSet);
 
         clearSel();
@@ -238,6 +317,10 @@ class LatticeMapDM : public AttributeMapDM {
         if (!m_selectionSet.size()) {
             return false;
         }
+        markEdited();
+        for (auto sel : m_selectionSet) {
+            markDirty(sel);
+        }
         auto pointsUnmerged = getInternalMap().unmergePoints(m_selectionSet);
         clearSel();
         return pointsUnmerged;
@@ -261,6 +344,8 @@ class LatticeMapDM : public AttributeMapDM {
         } else if (!add && (pt.getState() & Point::FILLED)) {
             m_pointUndoCounter[pix] = ++m_undocounter;
         }
+        markEdited();
+        markDirty(pix);
         return getInternalMap().fillPoint(p, add);
     }
     auto depixelate(const PixelRef &p, double scalefactor = 1.0) const {
@@ -273,6 +358,8 @@ class LatticeMapDM : public AttributeMapDM {
     auto &getPoint(const PixelRef &p) const { return getInternalMap().getPoint(p); }
     auto &getPoint(const PixelRef &p) { return getInternalMap().getPoint(p); }
     bool makePoints(const Point2f &seed, int fillType, Communicator *comm) {
+        markEdited();
+        markAllDirty();
         bool result = getInternalMap().makePoints(seed, fillType, comm);
         if (result) {
             m_undocounter++; // undo counter increased ready for fill...
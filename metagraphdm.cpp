@@ -36,8 +36,29 @@
 #include "salalib/vgamodules/vgavisualglobaldepth.hpp"
 #include "salalib/vgamodules/vgavisuallocal.hpp"
 
+#include "axialintegrationparallel.hpp"
+#include "metricbucketsearch.hpp"
+#include "originmask.hpp"
+#include "segmenttopometmultiradius.hpp"
+#include "segmenttulipbins.hpp"
+#include "shapegraphcsr.hpp"
+#include "vgaangularbucket.hpp"
+#include "vgaangulardepthbucket.hpp"
+#include "vgaangularmultiradius.hpp"
+#include "vgametricbucket.hpp"
+#include "vgametricdepthbatch.hpp"
+#include "vgametricdepthbucket.hpp"
+#include "vgametricmultiradius.hpp"
+#include "vgamultisourcedepth.hpp"
+#include "vgasampleddepth.hpp"
+#include "vgavisualfused.hpp"
+#include "vgavisualglobalbitmap.hpp"
+#include "vgavisualglobaldepthbitmap.hpp"
+#include "vgavisualmultiradius.hpp"
+
 #include "salalib/genlib/comm.hpp"
 
+#include <algorithm>
 #include <tuple>
 
 MetaGraphDM::MetaGraphDM(std::string name)
@@ -272,10 +293,15 @@ bool MetaGraphDM::makeGraph(Communicator *communicator, int algorithm, double ma
 
     try {
         std::vector<Line4f> lines = getShownDrawingFilesAsLines();
+        getDisplayedLatticeMap().markEdited();
+        getDisplayedLatticeMap().markGraphInputs(lines, algorithm != 0, maxdist);
         getDisplayedLatticeMap().getInternalMap().blockLines(lines);
         // algorithm is now used for boundary graph option (as a simple boolean)
         graphMade = getDisplayedLatticeMap().getInternalMap().sparkGraph2(
             communicator, (algorithm != 0), maxdist);
+        if (graphMade) {
+            getDisplayedLatticeMap().makeGraphSnapshot();
+        }
         getDisplayedLatticeMap().setDisplayedAttribute(LatticeMap::Column::CONNECTIVITY);
     } catch (Communicator::CancelledException) {
         graphMade = false;
@@ -289,6 +315,7 @@ bool MetaGraphDM::makeGraph(Communicator *communicator, int algorithm, double ma
 }
 
 bool MetaGraphDM::unmakeGraph(bool removeLinks) {
+    getDisplayedLatticeMap().markEdited();
     bool graphUnmade = getDisplayedLatticeMap().getInternalMap().unmake(removeLinks);
 
     getDisplayedLatticeMap().setDisplayedAttribute(-2);
@@ -335,9 +362,15 @@ bool MetaGraphDM::analyseGraph(Communicator *communicator, int pointDepthSelecti
             } else if (m_viewClass & DX_VIEWAXIAL) {
                 if (!getDisplayedShapeGraph().getInternalMap().isSegmentMap()) {
                     auto &map = getDisplayedShapeGraph();
-                    analysisCompleted = AxialStepDepth(map.getSelSet())
-                                            .run(communicator, map.getInternalMap(), false)
-                                            .completed;
+                    auto *depthStore = map.getDepthStore();
+                    if (depthStore != nullptr && depthStore->matches(map.getInternalMap())) {
+                        analysisCompleted =
+                            depthStore->writeStepDepth(map.getInternalMap(), map.getSelSet());
+                    } else {
+                        analysisCompleted = AxialStepDepth(map.getSelSet())
+                                                .run(communicator, map.getInternalMap(), false)
+                                                .completed;
+                    }
                     map.setDisplayedAttribute(-1); // <- override if it's already showing
                     map.setDisplayedAttribute(AxialStepDepth::Column::STEP_DEPTH);
                 } else {
@@ -375,9 +408,15 @@ bool MetaGraphDM::analyseGraph(Communicator *communicator, int pointDepthSelecti
                        getDisplayedShapeGraph().getInternalMap().isSegmentMap()) {
 
                 auto &map = getDisplayedShapeGraph();
-                analysisCompleted = SegmentMetricPD(map.getSelSet())
-                                        .run(communicator, map.getInternalMap(), false)
-                                        .completed;
+                auto *metricHierarchy = map.getMetricHierarchy();
+                if (metricHierarchy != nullptr && metricHierarchy->matches(map.getInternalMap())) {
+                    analysisCompleted = metricHierarchy->writeMetricStepDepth(map.getInternalMap(),
+                                                                              map.getSelSet());
+                } else {
+                    analysisCompleted = SegmentMetricPD(map.getSelSet())
+                                            .run(communicator, map.getInternalMap(), false)
+                                            .completed;
+                }
                 map.setDisplayedAttribute(SegmentMetricPD::Column::METRIC_STEP_DEPTH);
             }
         } else if (pointDepthSelection == 3) {
@@ -490,6 +529,467 @@ bool MetaGraphDM::analyseGraph(Communicator *communicator, int pointDepthSelecti
     return analysisCompleted;
 }
 
+bool MetaGraphDM::analyseGraph(Communicator *communicator, const Options &options,
+                               bool simpleVersion) {
+    if (options.pointDepthSelection == 0 &&
+        (options.samplePivots > 0 || options.sampleTargetError > 0.0) &&
+        (options.outputType == AnalysisType::METRIC ||
+         options.outputType == AnalysisType::ANGULAR ||
+         (options.outputType == AnalysisType::VISUAL && options.global && !options.gatesOnly))) {
+        bool localCompleted = true;
+        if (options.outputType == AnalysisType::VISUAL && options.local) {
+            localCompleted = analyseGraph(communicator, 0, AnalysisType::VISUAL, options.local,
+                                          false, 0, options.radius, simpleVersion);
+        }
+        return analyseGraphSampled(communicator, options.outputType,
+                                   static_cast<size_t>(std::max(options.samplePivots, 0)),
+                                   options.sampleTargetError) &&
+               localCompleted;
+    }
+    if (options.pointDepthSelection == 0 && options.outputType == AnalysisType::VISUAL &&
+        options.fusedVisual && options.local && options.global && !options.gatesOnly) {
+        auto *state = getDisplayedLatticeMap().getIncrementalState();
+        if (options.incremental && !options.fusedIsovist && state != nullptr &&
+            state->getRadius() == options.radius && state->isSimpleVersion() == simpleVersion) {
+            return analyseVisualIncremental(communicator);
+        }
+        return analyseVisualFused(communicator, options.radius, options.fusedIsovist,
+                                  simpleVersion);
+    }
+    if (options.bucketMetric && options.pointDepthSelection == 0 &&
+        options.outputType == AnalysisType::METRIC && !options.gatesOnly) {
+        return analyseMetricBucket(communicator,
+                                   options.radiusSet.empty() ? std::set<double>{options.radius}
+                                                             : options.radiusSet,
+                                   static_cast<size_t>(std::max(options.threadCount, 0)));
+    }
+    if (options.bucketMetric && options.pointDepthSelection == 2 && m_viewClass & DX_VIEWVGA &&
+        !getDisplayedLatticeMap().getAttributeTable().hasColumn(
+            VGAMetricDepthLinkCost::Column::LINK_METRIC_COST)) {
+        return analyseMetricDepthBucket(communicator);
+    }
+    if (options.bucketAngular && options.pointDepthSelection == 0 &&
+        options.outputType == AnalysisType::ANGULAR && !options.gatesOnly) {
+        return analyseAngularBucket(communicator,
+                                    options.radiusSet.empty() ? std::set<double>{options.radius}
+                                                              : options.radiusSet,
+                                    static_cast<size_t>(std::max(options.threadCount, 0)));
+    }
+    if (options.bucketAngular && options.pointDepthSelection == 3 && m_viewClass & DX_VIEWVGA) {
+        return analyseAngularDepthBucket(communicator);
+    }
+    if (options.pointDepthSelection == 0 && !options.radiusSet.empty() &&
+        (options.outputType == AnalysisType::METRIC ||
+         options.outputType == AnalysisType::ANGULAR ||
+         (options.outputType == AnalysisType::VISUAL && options.global && !options.gatesOnly))) {
+        bool localCompleted = true;
+        if (options.outputType == AnalysisType::VISUAL && options.local) {
+            localCompleted = analyseGraph(communicator, 0, AnalysisType::VISUAL, options.local,
+                                          false, 0, options.radius, simpleVersion);
+        }
+        return analyseGraphMultiRadius(communicator, options.outputType, options.radiusSet,
+                                       simpleVersion) &&
+               localCompleted;
+    }
+    if (options.bitmapFrontier && options.pointDepthSelection == 1 && m_viewClass & DX_VIEWVGA) {
+        return analyseVisualStepDepthBitmap(communicator);
+    }
+    if (options.bitmapFrontier && options.pointDepthSelection == 0 &&
+        options.outputType == AnalysisType::VISUAL && options.global && !options.gatesOnly) {
+        bool localCompleted = true;
+        if (options.local) {
+            localCompleted = analyseGraph(communicator, 0, AnalysisType::VISUAL, options.local,
+                                          false, 0, options.radius, simpleVersion);
+        }
+        return analyseVisualGlobalBitmap(communicator, options.radius, simpleVersion) &&
+               localCompleted;
+    }
+    return analyseGraph(communicator, options.pointDepthSelection, options.outputType,
+                        options.local, options.gatesOnly, options.global, options.radius,
+                        simpleVersion);
+}
+
+bool MetaGraphDM::analyseVisualFused(Communicator *communicator, double radius, bool withIsovist,
+                                     bool simpleVersion) {
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedLatticeMap();
+        auto graph = map.getGraphSnapshot();
+        if (!graph) {
+            return false;
+        }
+        BSPNodeTree *bspTree = nullptr;
+        if (withIsovist && makeBSPtree(m_bspNodeTree, communicator)) {
+            bspTree = &m_bspNodeTree;
+        }
+        analysisCompleted =
+            VGAVisualFused(map.getInternalMap(), *graph, radius, simpleVersion, bspTree,
+                           m_metaGraph.region)
+                .run(communicator);
+        // the isovist columns are not kept up to date incrementally
+        map.setIncrementalState(analysisCompleted && bspTree == nullptr
+                                    ? std::make_unique<VGAIncrementalState>(graph, radius,
+                                                                            simpleVersion)
+                                    : nullptr);
+        map.clearDirtyRegion();
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAVisualGlobal::getColumnWithRadius(
+            VGAVisualGlobal::Column::VISUAL_INTEGRATION_HH, radius));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseVisualIncremental(Communicator *communicator) {
+    auto &map = getDisplayedLatticeMap();
+    auto *state = map.getIncrementalState();
+    auto graph = map.getGraphSnapshot();
+    if (state == nullptr || !graph) {
+        return false;
+    }
+    if (state->isGraph(graph)) {
+        // nothing has changed since
+        return true;
+    }
+    const double radius = state->getRadius();
+    const bool simpleVersion = state->isSimpleVersion();
+
+    state->captureValues(map.getInternalMap().getAttributeTable());
+    std::vector<bool> affected = state->findAffectedOrigins(
+        *graph, map.hasDirtyRegion() ? std::make_optional(map.getDirtyRegion()) : std::nullopt);
+
+    bool analysisCompleted = false;
+    try {
+        VGAVisualFused analysis(map.getInternalMap(), *graph, radius, simpleVersion);
+        analysis.setOriginFilter(affected);
+        analysisCompleted = analysis.run(communicator);
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+    // the analysis resets the columns, the origins it did not reach get their values back
+    state->restoreValues(map.getInternalMap().getAttributeTable(), *graph, affected);
+
+    if (analysisCompleted) {
+        map.setIncrementalState(
+            std::make_unique<VGAIncrementalState>(graph, radius, simpleVersion));
+        map.clearDirtyRegion();
+    }
+    map.setDisplayedAttribute(-2);
+    map.setDisplayedAttribute(VGAVisualGlobal::getColumnWithRadius(
+        VGAVisualGlobal::Column::VISUAL_INTEGRATION_HH, radius));
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseGraphMultiRadius(Communicator *communicator, AnalysisType outputType,
+                                          const std::set<double> &radiusSet,
+                                          bool simpleVersion) {
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedLatticeMap();
+        auto graph = map.getGraphSnapshot();
+        if (!graph) {
+            return false;
+        }
+        double displayRadius = *radiusSet.begin();
+        if (outputType == AnalysisType::VISUAL) {
+            analysisCompleted =
+                VGAVisualGlobalMultiRadius(map.getInternalMap(), *graph, radiusSet, simpleVersion)
+                    .run(communicator);
+            map.setDisplayedAttribute(-2);
+            map.setDisplayedAttribute(VGAVisualGlobal::getColumnWithRadius(
+                VGAVisualGlobal::Column::VISUAL_INTEGRATION_HH, displayRadius));
+        } else if (outputType == AnalysisType::METRIC) {
+            analysisCompleted =
+                VGAMetricMultiRadius(map.getInternalMap(), *graph, radiusSet).run(communicator);
+            map.overrideDisplayedAttribute(-2);
+            map.setDisplayedAttribute(VGAMetric::getColumnWithRadius(
+                VGAMetric::Column::METRIC_MEAN_SHORTEST_PATH_DISTANCE, displayRadius,
+                map.getInternalMap().getRegion()));
+        } else if (outputType == AnalysisType::ANGULAR) {
+            analysisCompleted =
+                VGAAngularMultiRadius(map.getInternalMap(), *graph, radiusSet).run(communicator);
+            map.overrideDisplayedAttribute(-2);
+            map.setDisplayedAttribute(
+                VGAAngular::getColumnWithRadius(VGAAngular::Column::ANGULAR_MEAN_DEPTH,
+                                                displayRadius, map.getInternalMap().getRegion()));
+        }
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseVisualGlobalBitmap(Communicator *communicator, double radius,
+                                            bool simpleVersion) {
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedLatticeMap();
+        auto graph = map.getGraphSnapshot();
+        if (!graph) {
+            return false;
+        }
+        analysisCompleted =
+            VGAVisualGlobalBitmap(map.getInternalMap(), *graph, radius, simpleVersion)
+                .run(communicator);
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAVisualGlobal::getColumnWithRadius(
+            VGAVisualGlobal::Column::VISUAL_INTEGRATION_HH, radius));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseVisualStepDepthBitmap(Communicator *communicator) {
+    auto &map = getDisplayedLatticeMap();
+    if (!map.isSelected()) {
+        return false;
+    }
+    auto graph = map.getGraphSnapshot();
+    if (!graph) {
+        return false;
+    }
+
+    bool analysisCompleted = false;
+    try {
+        std::set<PixelRef> origins;
+        for (auto &sel : map.getSelSet())
+            origins.insert(sel);
+        analysisCompleted =
+            VGAVisualGlobalDepthBitmap(map.getInternalMap(), *graph, std::move(origins))
+                .run(communicator);
+
+        // force redisplay:
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAVisualGlobalDepth::Column::VISUAL_STEP_DEPTH);
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseMetricBucket(Communicator *communicator,
+                                      const std::set<double> &radiusSet, size_t threadCount) {
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedLatticeMap();
+        auto graph = map.getGraphSnapshot();
+        if (!graph || radiusSet.empty()) {
+            return false;
+        }
+        analysisCompleted =
+            VGAMetricBucket(map.getInternalMap(), *graph, radiusSet, threadCount)
+                .run(communicator);
+        map.overrideDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAMetric::getColumnWithRadius(
+            VGAMetric::Column::METRIC_MEAN_SHORTEST_PATH_DISTANCE, *radiusSet.begin(),
+            map.getInternalMap().getRegion()));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseMetricDepthBucket(Communicator *communicator) {
+    auto &map = getDisplayedLatticeMap();
+    if (!map.isSelected()) {
+        return false;
+    }
+    auto graph = map.getGraphSnapshot();
+    if (!graph) {
+        return false;
+    }
+
+    bool analysisCompleted = false;
+    try {
+        std::set<PixelRef> origins;
+        for (auto &sel : map.getSelSet())
+            origins.insert(sel);
+        analysisCompleted =
+            VGAMetricDepthBucket(map.getInternalMap(), *graph, std::move(origins))
+                .run(communicator);
+
+        // force redisplay:
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAMetricDepth::Column::METRIC_STEP_SHORTEST_PATH_LENGTH);
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseAngularBucket(Communicator *communicator,
+                                       const std::set<double> &radiusSet, size_t threadCount) {
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedLatticeMap();
+        auto graph = map.getGraphSnapshot();
+        if (!graph || radiusSet.empty()) {
+            return false;
+        }
+        analysisCompleted =
+            VGAAngularBucket(map.getInternalMap(), *graph, radiusSet, threadCount)
+                .run(communicator);
+        map.overrideDisplayedAttribute(-2);
+        map.setDisplayedAttribute(
+            VGAAngular::getColumnWithRadius(VGAAngular::Column::ANGULAR_MEAN_DEPTH,
+                                            *radiusSet.begin(), map.getInternalMap().getRegion()));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseAngularDepthBucket(Communicator *communicator) {
+    auto &map = getDisplayedLatticeMap();
+    if (!map.isSelected()) {
+        return false;
+    }
+    auto graph = map.getGraphSnapshot();
+    if (!graph) {
+        return false;
+    }
+
+    bool analysisCompleted = false;
+    try {
+        std::set<PixelRef> origins;
+        for (auto &sel : map.getSelSet()) {
+            origins.insert(sel);
+        }
+        analysisCompleted =
+            VGAAngularDepthBucket(map.getInternalMap(), *graph, std::move(origins))
+                .run(communicator);
+
+        // force redisplay:
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAAngularDepth::Column::ANGULAR_STEP_DEPTH);
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseGraphSampled(Communicator *communicator, AnalysisType outputType,
+                                      size_t pivotCount, double targetError) {
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedLatticeMap();
+        auto graph = map.getGraphSnapshot();
+        if (!graph) {
+            return false;
+        }
+        analysisCompleted =
+            VGASampledDepth(map.getInternalMap(), *graph, outputType, pivotCount, targetError)
+                .run(communicator);
+        std::string displayColumn = VGAVisualGlobal::Column::VISUAL_INTEGRATION_HH;
+        if (outputType == AnalysisType::METRIC) {
+            displayColumn = VGAMetric::Column::METRIC_MEAN_SHORTEST_PATH_DISTANCE;
+        } else if (outputType == AnalysisType::ANGULAR) {
+            displayColumn = VGAAngular::Column::ANGULAR_MEAN_DEPTH;
+        }
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGASampledDepth::getApproxColumn(displayColumn));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseVisualStepDepthPerOrigin(Communicator *communicator,
+                                                  std::vector<std::set<int>> originGroups) {
+    if (!(m_viewClass & DX_VIEWVGA)) {
+        return false;
+    }
+    auto &map = getDisplayedLatticeMap();
+    if (originGroups.empty()) {
+        for (auto &sel : map.getSelSet()) {
+            originGroups.push_back({sel});
+        }
+    }
+    auto graph = map.getGraphSnapshot();
+    if (originGroups.empty() || !graph) {
+        return false;
+    }
+
+    std::vector<std::set<PixelRef>> origins;
+    origins.reserve(originGroups.size());
+    for (auto &group : originGroups) {
+        origins.emplace_back(group.begin(), group.end());
+    }
+
+    bool analysisCompleted = false;
+    try {
+        analysisCompleted =
+            VGAMultiSourceDepth(map.getInternalMap(), *graph, std::move(origins)).run(communicator);
+
+        // force redisplay:
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAMultiSourceDepth::getColumnWithGroup(
+            VGAMultiSourceDepth::Column::VISUAL_STEP_DEPTH, 0));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
+bool MetaGraphDM::analyseMetricDepthPerOrigin(Communicator *communicator,
+                                              std::vector<std::set<int>> originGroups,
+                                              size_t threadCount) {
+    if (!(m_viewClass & DX_VIEWVGA)) {
+        return false;
+    }
+    auto &map = getDisplayedLatticeMap();
+    if (originGroups.empty()) {
+        for (auto &sel : map.getSelSet()) {
+            originGroups.push_back({sel});
+        }
+    }
+    auto graph = map.getGraphSnapshot();
+    if (originGroups.empty() || !graph) {
+        return false;
+    }
+
+    std::vector<std::set<PixelRef>> origins;
+    origins.reserve(originGroups.size());
+    for (auto &group : originGroups) {
+        origins.emplace_back(group.begin(), group.end());
+    }
+
+    bool analysisCompleted = false;
+    try {
+        analysisCompleted =
+            VGAMetricDepthBatch(map.getInternalMap(), *graph, std::move(origins), threadCount)
+                .run(communicator);
+
+        // force redisplay:
+        map.setDisplayedAttribute(-2);
+        map.setDisplayedAttribute(VGAMetricDepthBatch::getColumnWithGroup(
+            VGAMetricDepth::Column::METRIC_STEP_SHORTEST_PATH_LENGTH, 0));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    return analysisCompleted;
+}
+
 //////////////////////////////////////////////////////////////////
 
 bool MetaGraphDM::isEditableMap() {
@@ -1416,7 +1916,8 @@ bool MetaGraphDM::makeFewestLineMap(Communicator *communicator, int replace) {
 
 bool MetaGraphDM::analyseAxial(Communicator *communicator, std::set<double> radiusSet,
                                int weightedMeasureCol, bool choice, bool fulloutput,
-                               bool localAnalysis, bool forceLegacyColumnOrder) {
+                               bool localAnalysis, bool forceLegacyColumnOrder,
+                               size_t threadCount) {
     m_state &= ~DX_SHAPEGRAPHS; // Clear axial map data flag (stops accidental redraw
                                 // during reload)
 
@@ -1424,9 +1925,20 @@ bool MetaGraphDM::analyseAxial(Communicator *communicator, std::set<double> radi
 
     try {
         auto &map = getDisplayedShapeGraph();
-        AxialIntegration analysis(radiusSet, weightedMeasureCol, choice, fulloutput);
-        analysis.setForceLegacyColumnOrder(forceLegacyColumnOrder);
-        analysisCompleted = analysis.run(communicator, map.getInternalMap(), false).completed;
+        // the parallel engine gives the local measures from the same traversal
+        bool parallel = threadCount != 1 && weightedMeasureCol == -1 && !fulloutput &&
+                        !forceLegacyColumnOrder;
+        if (parallel) {
+            ShapeGraphCSR graph(map.getInternalMap(), map.getAnalysisOrdering());
+            analysisCompleted =
+                AxialIntegrationParallel(map.getInternalMap(), graph, radiusSet, choice,
+                                         localAnalysis, threadCount)
+                    .run(communicator);
+        } else {
+            AxialIntegration analysis(radiusSet, weightedMeasureCol, choice, fulloutput);
+            analysis.setForceLegacyColumnOrder(forceLegacyColumnOrder);
+            analysisCompleted = analysis.run(communicator, map.getInternalMap(), false).completed;
+        }
 
         map.setDisplayedAttribute(-1); // <- override if it's already showing
 
@@ -1435,7 +1947,7 @@ bool MetaGraphDM::analyseAxial(Communicator *communicator, std::set<double> radi
             static_cast<int>(*radiusSet.rbegin()), std::nullopt,
             AxialIntegration::Normalisation::HH)));
 
-        if (localAnalysis)
+        if (localAnalysis && !parallel)
             analysisCompleted &=
                 AxialLocal()
                     .run(communicator, getDisplayedShapeGraph().getInternalMap(), false)
@@ -1449,24 +1961,331 @@ bool MetaGraphDM::analyseAxial(Communicator *communicator, std::set<double> radi
     return analysisCompleted;
 }
 
+bool MetaGraphDM::makeAxialDepthStore(Communicator *communicator, const std::string &fileName,
+                                      size_t threadCount) {
+    bool completed = false;
+
+    try {
+        auto &map = getDisplayedShapeGraph();
+        map.clearDepthStore();
+        ShapeGraphCSR graph(map.getInternalMap());
+        auto depthStore = std::make_unique<AxialDepthStore>();
+        completed = depthStore->build(map.getInternalMap(), graph, communicator, threadCount,
+                                      fileName);
+        if (completed) {
+            map.setDepthStore(std::move(depthStore));
+        }
+    } catch (Communicator::CancelledException) {
+        completed = false;
+    }
+
+    return completed;
+}
+
+bool MetaGraphDM::openAxialDepthStore(const std::string &fileName) {
+    auto &map = getDisplayedShapeGraph();
+    auto depthStore = std::make_unique<AxialDepthStore>();
+    if (!depthStore->open(map.getInternalMap(), fileName)) {
+        return false;
+    }
+    map.setDepthStore(std::move(depthStore));
+    return true;
+}
+
+bool MetaGraphDM::makeSegmentMetricHierarchy(Communicator *communicator) {
+    bool completed = false;
+
+    try {
+        auto &map = getDisplayedShapeGraph();
+        map.clearMetricHierarchy();
+        ShapeGraphCSR graph(map.getInternalMap());
+        auto metricHierarchy = std::make_unique<SegmentMetricHierarchy>();
+        completed = metricHierarchy->build(map.getInternalMap(), graph, communicator);
+        if (completed) {
+            map.setMetricHierarchy(std::move(metricHierarchy));
+        }
+    } catch (Communicator::CancelledException) {
+        completed = false;
+    }
+
+    return completed;
+}
+
+std::optional<std::vector<double>>
+MetaGraphDM::getSegmentMetricDistances(const std::vector<int> &originRefs,
+                                       const std::vector<int> &destinationRefs) {
+    auto &map = getDisplayedShapeGraph();
+    auto *metricHierarchy = map.getMetricHierarchy();
+    if (metricHierarchy == nullptr || !metricHierarchy->matches(map.getInternalMap())) {
+        return std::nullopt;
+    }
+    return metricHierarchy->getDistanceTable(originRefs, destinationRefs);
+}
+
+// where two connected lines meet: where they cross, or between their nearest ends if they run
+// the same way
+static Point2f getMeetingPoint(const Line4f &a, const Line4f &b) {
+    const Point2f alongA = a.end() - a.start();
+    const Point2f alongB = b.end() - b.start();
+    const double denominator = alongA.x * alongB.y - alongA.y * alongB.x;
+    if (std::fabs(denominator) > 1e-9 * alongA.length() * alongB.length()) {
+        const Point2f between = b.start() - a.start();
+        const double t = (between.x * alongB.y - between.y * alongB.x) / denominator;
+        return Point2f(a.start().x + alongA.x * t, a.start().y + alongA.y * t);
+    }
+    Point2f nearestA = a.start(), nearestB = b.start();
+    for (const auto &endA : {a.start(), a.end()}) {
+        for (const auto &endB : {b.start(), b.end()}) {
+            if (dist(endA, endB) < dist(nearestA, nearestB)) {
+                nearestA = endA;
+                nearestB = endB;
+            }
+        }
+    }
+    return Point2f((nearestA.x + nearestB.x) * 0.5, (nearestA.y + nearestB.y) * 0.5);
+}
+
+std::vector<int> MetaGraphDM::makeRoute(int fromRef, int toRef, RouteSearch::Cost cost,
+                                        bool draw, bool keepPrevious) {
+    auto &map = getDisplayedShapeGraph();
+    auto &routeGraph = map.getRouteGraph();
+    const ShapeGraphCSR &graph = routeGraph.getGraph();
+    RouteSearch &search = routeGraph.getSearch(cost);
+    std::vector<int> route;
+    for (uint32_t line : search.run(graph.getLine(fromRef), graph.getLine(toRef))) {
+        route.push_back(graph.getRef(line));
+    }
+    if (route.empty() || !draw) {
+        return route;
+    }
+
+    // from the middle of the first shape through the points where the shapes meet to the middle
+    // of the last, or along the shape if the route is just the one
+    const auto &shapes = map.getInternalMap().getAllShapes();
+    std::vector<Point2f> polyline;
+    if (route.size() == 1) {
+        polyline = {shapes.at(route.front()).getLine().start(),
+                    shapes.at(route.front()).getLine().end()};
+    } else {
+        polyline.push_back(shapes.at(route.front()).getCentroid());
+        for (size_t i = 1; i < route.size(); i++) {
+            polyline.push_back(getMeetingPoint(shapes.at(route[i - 1]).getLine(),
+                                               shapes.at(route[i]).getLine()));
+        }
+        polyline.push_back(shapes.at(route.back()).getCentroid());
+    }
+
+    size_t routeLayer = 0;
+    auto mapRef = getMapRef(m_dataMaps, "Routes");
+    if (!mapRef.has_value()) {
+        m_dataMaps.emplace_back("Routes", ShapeMap::DATAMAP);
+        setDisplayedDataMapRef(m_dataMaps.size() - 1);
+        routeLayer = m_dataMaps.size() - 1;
+        m_state |= DX_DATAMAPS;
+    } else {
+        routeLayer = mapRef.value();
+    }
+    auto &routeMap = m_dataMaps[routeLayer];
+    if (!keepPrevious) {
+        routeMap.clearAll();
+    }
+    // true: open polyline
+    int polyref = routeMap.getInternalMap().makePolyShape(polyline, true);
+    AttributeTable &table = routeMap.getInternalMap().getAttributeTable();
+    auto getColumn = [&table](const std::string &name) {
+        return table.hasColumn(name) ? table.getColumnIndex(name)
+                                     : table.insertOrResetColumn(name);
+    };
+    auto costCol = getColumn("Route Cost");
+    auto lengthCol = getColumn("Route Length");
+    AttributeRow &row = table.getRow(AttributeKey(polyref));
+    row.setValue(costCol, static_cast<float>(search.getCost()));
+    row.setValue(lengthCol, static_cast<float>(search.getDistance()));
+    routeMap.overrideDisplayedAttribute(-2);
+    routeMap.setDisplayedAttribute(-1);
+    return route;
+}
+
+// the corners of the smallest convex polygon around the points, anticlockwise
+static std::vector<Point2f> getConvexHull(std::vector<Point2f> points) {
+    std::sort(points.begin(), points.end(), [](const Point2f &a, const Point2f &b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    auto turn = [](const Point2f &o, const Point2f &a, const Point2f &b) {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    };
+    if (points.size() < 3) {
+        return points;
+    }
+    // the lower half left to right, then the upper half back
+    std::vector<Point2f> hull(2 * points.size());
+    size_t count = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        while (count >= 2 && turn(hull[count - 2], hull[count - 1], points[i]) <= 0) {
+            count--;
+        }
+        hull[count++] = points[i];
+    }
+    for (size_t i = points.size() - 1, lower = count + 1; i > 0; i--) {
+        while (count >= lower && turn(hull[count - 2], hull[count - 1], points[i - 1]) <= 0) {
+            count--;
+        }
+        hull[count++] = points[i - 1];
+    }
+    // the last is the first again
+    hull.resize(count - 1);
+    return hull;
+}
+
+void MetaGraphDM::drawCatchmentHull(std::vector<Point2f> points, double cutoff) {
+    std::vector<Point2f> hull = getConvexHull(std::move(points));
+    if (hull.size() < 3) {
+        return;
+    }
+    size_t catchmentLayer = 0;
+    auto mapRef = getMapRef(m_dataMaps, "Catchments");
+    if (!mapRef.has_value()) {
+        m_dataMaps.emplace_back("Catchments", ShapeMap::DATAMAP);
+        setDisplayedDataMapRef(m_dataMaps.size() - 1);
+        catchmentLayer = m_dataMaps.size() - 1;
+        m_state |= DX_DATAMAPS;
+    } else {
+        catchmentLayer = mapRef.value();
+    }
+    auto &catchmentMap = m_dataMaps[catchmentLayer];
+    // false: closed polygon
+    int polyref = catchmentMap.getInternalMap().makePolyShape(hull, false);
+    AttributeTable &table = catchmentMap.getInternalMap().getAttributeTable();
+    auto cutoffCol = table.hasColumn("Catchment Cut-off")
+                         ? table.getColumnIndex("Catchment Cut-off")
+                         : table.insertOrResetColumn("Catchment Cut-off");
+    AttributeRow &row = table.getRow(AttributeKey(polyref));
+    row.setValue(cutoffCol, static_cast<float>(cutoff));
+    catchmentMap.overrideDisplayedAttribute(-2);
+    catchmentMap.setDisplayedAttribute(-1);
+}
+
+std::map<int, double> MetaGraphDM::makeCatchment(const std::set<int> &originRefs,
+                                                 RouteSearch::Cost cost,
+                                                 const std::vector<double> &cutoffs, bool draw) {
+    std::map<int, double> catchment;
+    if (cutoffs.empty()) {
+        return catchment;
+    }
+    auto &map = getDisplayedShapeGraph();
+    auto &routeGraph = map.getRouteGraph();
+    const ShapeGraphCSR &graph = routeGraph.getGraph();
+    std::vector<uint32_t> origins;
+    for (int ref : originRefs) {
+        origins.push_back(graph.getLine(ref));
+    }
+    RouteSearch &search = routeGraph.getSearch(cost);
+    const double limit = *std::max_element(cutoffs.begin(), cutoffs.end());
+    const auto reached = search.getCatchment(origins, limit);
+    for (const auto &[line, lineCost] : reached) {
+        catchment.emplace(graph.getRef(line), lineCost);
+    }
+    if (!draw) {
+        return catchment;
+    }
+
+    // the lines come in order of cost, so every cut-off takes the lines up to some point
+    const auto &shapes = map.getInternalMap().getAllShapes();
+    for (double cutoff : cutoffs) {
+        std::vector<Point2f> points;
+        for (const auto &[line, lineCost] : reached) {
+            if (lineCost > cutoff) {
+                break;
+            }
+            const Line4f &shapeLine = shapes.at(graph.getRef(line)).getLine();
+            points.push_back(shapeLine.start());
+            points.push_back(shapeLine.end());
+        }
+        drawCatchmentHull(std::move(points), cutoff);
+    }
+    return catchment;
+}
+
+std::map<PixelRef, double> MetaGraphDM::makeVGACatchment(const std::set<PixelRef> &originRefs,
+                                                         const std::vector<double> &cutoffs,
+                                                         bool draw) {
+    std::map<PixelRef, double> catchment;
+    if (cutoffs.empty()) {
+        return catchment;
+    }
+    auto *catchmentSearch = getDisplayedLatticeMap().getCatchmentSearch();
+    if (catchmentSearch == nullptr) {
+        return catchment;
+    }
+    const LatticeGraphCSR *graph = catchmentSearch->graph.get();
+    const auto &locations = catchmentSearch->locations;
+    std::vector<uint32_t> origins;
+    for (const PixelRef &ref : originRefs) {
+        uint32_t cell = graph->getCell(ref);
+        if (cell != LatticeGraphCSR::NO_CELL) {
+            origins.push_back(cell);
+        }
+    }
+    // in order of distance, as settled
+    std::vector<std::pair<uint32_t, double>> reached;
+    catchmentSearch->search->run(
+        origins, *std::max_element(cutoffs.begin(), cutoffs.end()),
+        [&](uint32_t cell, double dist, double) { reached.emplace_back(cell, dist); });
+    for (const auto &[cell, dist] : reached) {
+        catchment.emplace(graph->getRef(cell), dist);
+    }
+    if (!draw) {
+        return catchment;
+    }
+
+    for (double cutoff : cutoffs) {
+        std::vector<Point2f> points;
+        for (const auto &[cell, dist] : reached) {
+            if (dist > cutoff) {
+                break;
+            }
+            points.push_back(locations[cell]);
+        }
+        drawCatchmentHull(std::move(points), cutoff);
+    }
+    return catchment;
+}
+
 bool MetaGraphDM::analyseSegmentsTulip(Communicator *communicator, std::set<double> &radiusSet,
                                        bool selOnly, int tulipBins, int weightedMeasureCol,
                                        RadiusType radiusType, bool choice, int weightedMeasureCol2,
                                        int routeweightCol, bool interactive,
-                                       bool forceLegacyColumnOrder) {
+                                       bool forceLegacyColumnOrder, bool binQueue,
+                                       size_t threadCount, size_t publishInterval) {
     m_state &= ~DX_SHAPEGRAPHS; // Clear axial map data flag (stops accidental redraw
                                 // during reload)
 
     bool analysisCompleted = false;
+    auto &map = getDisplayedShapeGraph();
 
     try {
-        auto &map = getDisplayedShapeGraph();
-        SegmentTulip analysis(radiusSet,
-                              selOnly ? std::make_optional(map.getSelSet()) : std::nullopt,
-                              tulipBins, weightedMeasureCol, radiusType, choice,
-                              weightedMeasureCol2, routeweightCol, interactive);
-        analysis.setForceLegacyColumnOrder(forceLegacyColumnOrder);
-        analysisCompleted = analysis.run(communicator, map.getInternalMap(), false).completed;
+        if (binQueue && !choice && weightedMeasureCol == -1 && weightedMeasureCol2 == -1 &&
+            routeweightCol == -1 && !forceLegacyColumnOrder) {
+            ShapeGraphCSR graph(map.getInternalMap(), map.getAnalysisOrdering());
+            auto originMask = selOnly ? std::make_optional<OriginMask>(graph, map.getSelSet())
+                                      : std::nullopt;
+            SegmentTulipBins analysis(map.getInternalMap(), graph, radiusSet,
+                                      originMask ? &*originMask : nullptr, tulipBins, radiusType,
+                                      threadCount);
+            if (interactive) {
+                // made in full before the renderer can see it
+                map.setProgressiveColumn(analysis.makeProgressive(
+                    SegmentTulip::Column::TOTAL_DEPTH, *radiusSet.begin(), publishInterval));
+            }
+            analysisCompleted = analysis.run(communicator);
+        } else {
+            SegmentTulip analysis(radiusSet,
+                                  selOnly ? std::make_optional(map.getSelSet()) : std::nullopt,
+                                  tulipBins, weightedMeasureCol, radiusType, choice,
+                                  weightedMeasureCol2, routeweightCol, interactive);
+            analysis.setForceLegacyColumnOrder(forceLegacyColumnOrder);
+            analysisCompleted = analysis.run(communicator, map.getInternalMap(), false).completed;
+        }
         map.setDisplayedAttribute(-2); // <- override if it's already showing
         if (choice) {
             map.setDisplayedAttribute(static_cast<int>(SegmentTulip::getFormattedColumnIdx(
@@ -1480,6 +2299,8 @@ bool MetaGraphDM::analyseSegmentsTulip(Communicator *communicator, std::set<doub
     } catch (Communicator::CancelledException) {
         analysisCompleted = false;
     }
+    // the values are in the table now, or the analysis did not finish
+    map.setProgressiveColumn(nullptr);
 
     m_state |= DX_SHAPEGRAPHS;
 
@@ -1513,46 +2334,59 @@ bool MetaGraphDM::analyseSegmentsAngular(Communicator *communicator, std::set<do
 
 bool MetaGraphDM::analyseTopoMetMultipleRadii(Communicator *communicator,
                                               std::set<double> &radiusSet, AnalysisType outputType,
-                                              double radius, bool selOnly) {
+                                              double radius, bool selOnly, bool singlePass,
+                                              size_t threadCount) {
     m_state &= ~DX_SHAPEGRAPHS; // Clear axial map data flag (stops accidental redraw
                                 // during reload)
 
-    bool analysisCompleted = true;
+    bool analysisCompleted = false;
 
     try {
         // note: "outputType" reused for analysis type (either 0 = topological or 1
         // = metric)
         auto &map = getDisplayedShapeGraph();
-        for (size_t r = 0; r < radiusSet.size(); r++) {
-            if (outputType == AnalysisType::ISOVIST) {
-                if (!SegmentTopological(radius, selOnly ? std::make_optional(map.getSelSet())
-                                                        : std::nullopt)
-                         .run(communicator, map.getInternalMap(), false)
-                         .completed)
-                    analysisCompleted = false;
-                if (!selOnly) {
-                    map.setDisplayedAttribute(SegmentTopological::getFormattedColumn(
-                        SegmentTopological::Column::TOPOLOGICAL_CHOICE, radius));
-                } else {
-                    map.setDisplayedAttribute(SegmentTopological::getFormattedColumn(
-                        SegmentTopological::Column::TOPOLOGICAL_MEAN_DEPTH, radius));
-                }
-
-            } else {
-                if (!SegmentMetric(radius,
-                                   selOnly ? std::make_optional(map.getSelSet()) : std::nullopt)
-                         .run(communicator, map.getInternalMap(), false)
-                         .completed)
-                    analysisCompleted = false;
-                if (!selOnly) {
-                    map.setDisplayedAttribute(SegmentMetric::getFormattedColumn(
-                        SegmentMetric::Column::METRIC_CHOICE, radius));
+        bool topological = outputType == AnalysisType::ISOVIST;
+        if (singlePass) {
+            ShapeGraphCSR graph(map.getInternalMap(), map.getAnalysisOrdering());
+            auto originMask =
+                selOnly ? std::make_optional<OriginMask>(graph, map.getSelSet()) : std::nullopt;
+            analysisCompleted =
+                SegmentTopoMetMultiRadius(map.getInternalMap(), graph, radiusSet, topological,
+                                          originMask ? &*originMask : nullptr, threadCount)
+                    .run(communicator);
+        } else {
+            analysisCompleted = true;
+            for (double setRadius : radiusSet) {
+                auto selSet = selOnly ? std::make_optional(map.getSelSet()) : std::nullopt;
+                if (topological) {
+                    if (!SegmentTopological(setRadius, selSet)
+                             .run(communicator, map.getInternalMap(), false)
+                             .completed)
+                        analysisCompleted = false;
                 } else {
-                    map.setDisplayedAttribute(SegmentMetric::getFormattedColumn(
-                        SegmentMetric::Column::METRIC_MEAN_DEPTH, radius));
+                    if (!SegmentMetric(setRadius, selSet)
+                             .run(communicator, map.getInternalMap(), false)
+                             .completed)
+                        analysisCompleted = false;
                 }
             }
         }
+
+        // show the given radius if it was one of the set
+        double shownRadius =
+            radiusSet.empty() || radiusSet.count(radius) > 0 ? radius : *radiusSet.begin();
+        map.setDisplayedAttribute(-2); // <- override if it's already showing
+        if (topological) {
+            map.setDisplayedAttribute(SegmentTopological::getFormattedColumn(
+                selOnly ? SegmentTopological::Column::TOPOLOGICAL_MEAN_DEPTH
+                        : SegmentTopological::Column::TOPOLOGICAL_CHOICE,
+                shownRadius));
+        } else {
+            map.setDisplayedAttribute(SegmentMetric::getFormattedColumn(
+                selOnly ? SegmentMetric::Column::METRIC_MEAN_DEPTH
+                        : SegmentMetric::Column::METRIC_CHOICE,
+                shownRadius));
+        }
     } catch (Communicator::CancelledException) {
         analysisCompleted = false;
     }
@@ -1609,6 +2443,34 @@ bool MetaGraphDM::analyseTopoMet(Communicator *communicator, AnalysisType output
     return analysisCompleted;
 }
 
+bool MetaGraphDM::analyseSegmentChoiceSampled(Communicator *communicator,
+                                              SegmentChoiceSampled::Search search, double radius,
+                                              int tulipBins, RadiusType radiusType,
+                                              size_t sampleCount, double targetError,
+                                              size_t threadCount) {
+    m_state &= ~DX_SHAPEGRAPHS; // Clear axial map data flag (stops accidental redraw
+                                // during reload)
+
+    bool analysisCompleted = false;
+
+    try {
+        auto &map = getDisplayedShapeGraph();
+        ShapeGraphCSR graph(map.getInternalMap(), map.getAnalysisOrdering());
+        SegmentChoiceSampled analysis(map.getInternalMap(), graph, search, radius, tulipBins,
+                                      radiusType, sampleCount, targetError, threadCount);
+        analysisCompleted = analysis.run(communicator);
+        map.setDisplayedAttribute(-2); // <- override if it's already showing
+        map.setDisplayedAttribute(
+            SegmentChoiceSampled::getApproxColumn(analysis.getChoiceColumn()));
+    } catch (Communicator::CancelledException) {
+        analysisCompleted = false;
+    }
+
+    m_state |= DX_SHAPEGRAPHS;
+
+    return analysisCompleted;
+}
+
 size_t MetaGraphDM::loadLineData(Communicator *communicator, const std::string &fileName,
                                  int loadType) {
 
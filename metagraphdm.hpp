@@ -8,8 +8,12 @@
 
 // Interface: the meta graph loads and holds all sorts of arbitrary data...
 #include "latticemapdm.hpp"
+#include "options.hpp"
+#include "routesearch.hpp"
 #include "salalib/analysistype.hpp"
 #include "salalib/radiustype.hpp"
+#include "segmentchoicesampled.hpp"
+#include "segmenttulipbins.hpp"
 #include "shapegraphdm.hpp"
 #include "shapemapdm.hpp"
 #include "shapemapgroupdatadm.hpp"
@@ -22,6 +26,7 @@
 #include "salalib/metagraphreadwrite.hpp"
 #include "salalib/pushvalues.hpp"
 
+#include <map>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -207,6 +212,8 @@ class MetaGraphDM {
         }
         m_latticeMaps.erase(std::next(m_latticeMaps.begin(), static_cast<int>(i)));
     }
+    // the convex hull of the points into the "Catchments" data map, along with the cut-off
+    void drawCatchmentHull(std::vector<Point2f> points, double cutoff);
 
   public:
     int getState() const { return m_state; }
@@ -237,6 +244,40 @@ class MetaGraphDM {
     bool unmakeGraph(bool removeLinks);
     bool analyseGraph(Communicator *communicator, int pointDepthSelection, AnalysisType outputType,
                       int local, bool gatesOnly, int global, double radius, bool simpleVersion);
+    // as above, but also picks up the engine choices in the options
+    bool analyseGraph(Communicator *communicator, const Options &options, bool simpleVersion);
+    bool analyseVisualFused(Communicator *communicator, double radius, bool withIsovist,
+                            bool simpleVersion);
+    // brings the last fused visual analysis up to date after edits and a new graph, analysing
+    // only the origins the changes can reach
+    bool analyseVisualIncremental(Communicator *communicator);
+    // visual global, metric or angular analysis for all the radii in one pass over the origins,
+    // with one traversal per origin for visual and metric and one per radius for angular
+    bool analyseGraphMultiRadius(Communicator *communicator, AnalysisType outputType,
+                                 const std::set<double> &radiusSet, bool simpleVersion);
+    // visual global measures and step depth through the bitmap frontier search
+    bool analyseVisualGlobalBitmap(Communicator *communicator, double radius, bool simpleVersion);
+    bool analyseVisualStepDepthBitmap(Communicator *communicator);
+    // metric measures for all the radii and metric step depth through the bucket queue search
+    bool analyseMetricBucket(Communicator *communicator, const std::set<double> &radiusSet,
+                             size_t threadCount = 1);
+    bool analyseMetricDepthBucket(Communicator *communicator);
+    // angular measures for all the radii and angular step depth through the bucketed search
+    bool analyseAngularBucket(Communicator *communicator, const std::set<double> &radiusSet,
+                              size_t threadCount = 1);
+    bool analyseAngularDepthBucket(Communicator *communicator);
+    // approximate mean depth (and visual integration) from a sample of pivot origins
+    bool analyseGraphSampled(Communicator *communicator, AnalysisType outputType,
+                             size_t pivotCount, double targetError);
+    // one visual step depth column per origin group, all from a single traversal. Without
+    // any groups every selected point becomes a group of its own
+    bool analyseVisualStepDepthPerOrigin(Communicator *communicator,
+                                         std::vector<std::set<int>> originGroups = {});
+    // as above for metric step depth, with the link costs if the map has them, sharing the groups
+    // out among threads (0 for all the hardware threads)
+    bool analyseMetricDepthPerOrigin(Communicator *communicator,
+                                     std::vector<std::set<int>> originGroups = {},
+                                     size_t threadCount = 1);
     //
     // helpers for editing maps
     bool isEditableMap();
@@ -275,18 +316,71 @@ class MetaGraphDM {
     int loadMifMap(Communicator *comm, std::istream &miffile, std::istream &midfile);
     bool makeAllLineMap(Communicator *communicator, const Point2f &seed);
     bool makeFewestLineMap(Communicator *communicator, int replace);
+    // with threadCount other than 1 (0 for all the hardware threads) the origins are shared out
+    // among threads, for the unweighted measures without the full output, and the local
+    // measures come out of the same traversal
     bool analyseAxial(Communicator *communicator, std::set<double> radiusSet,
                       int weightedMeasureCol, bool choice, bool fulloutput, bool localAnalysis,
-                      bool forceLegacyColumnOrder = false);
+                      bool forceLegacyColumnOrder = false, size_t threadCount = 1);
+    // step depths between all the lines of the displayed axial map, made with threadCount threads
+    // (0 for all the hardware threads) and kept in fileName if given, so that the step depth of
+    // a selection is read off them instead of searched for
+    bool makeAxialDepthStore(Communicator *communicator, const std::string &fileName = "",
+                             size_t threadCount = 1);
+    // the step depths of an earlier makeAxialDepthStore, if made from the map as it is now
+    bool openAxialDepthStore(const std::string &fileName);
+    // a contraction hierarchy over the metric distances between the segments of the displayed
+    // segment map, so that the metric step depth of a selection and the distances between
+    // segments are read off it instead of searched for
+    bool makeSegmentMetricHierarchy(Communicator *communicator);
+    // the metric distances between the middles of the segments, a row per origin (-1 for those out
+    // of reach), or nothing if there is no hierarchy made from the map as it is now
+    std::optional<std::vector<double>>
+    getSegmentMetricDistances(const std::vector<int> &originRefs,
+                              const std::vector<int> &destinationRefs);
+    // The least cost route between two shapes of the displayed axial or segment map, as the keys
+    // of the shapes along it (empty if there is none). With draw, the route also goes into the
+    // "Routes" data map as a polyline through the points where the shapes meet, along with its
+    // cost and its metric length from the middle of the first shape to the middle of the last. It
+    // takes the place of the routes already there unless keepPrevious
+    std::vector<int> makeRoute(int fromRef, int toRef, RouteSearch::Cost cost, bool draw = true,
+                               bool keepPrevious = false);
+    // The shapes of the displayed axial or segment map within the largest of the cut-offs from
+    // any of the origins, with the least cost to each, by key. The search goes no further than
+    // that, so it only ever visits the catchment. With draw, the convex hull of the shapes within
+    // every cut-off goes into the "Catchments" data map
+    std::map<int, double> makeCatchment(const std::set<int> &originRefs, RouteSearch::Cost cost,
+                                        const std::vector<double> &cutoffs, bool draw = false);
+    // as makeCatchment, for the metric distance between the cells of the displayed VGA map
+    std::map<PixelRef, double> makeVGACatchment(const std::set<PixelRef> &originRefs,
+                                                const std::vector<double> &cutoffs,
+                                                bool draw = false);
+    // with binQueue the origins go through the tulip bin queue search, shared out among
+    // threadCount threads (0 for all the hardware threads), for the measures without weights or
+    // choice. When also interactive, the displayed column is published to the progressive column
+    // of the map every publishInterval origins while the analysis runs
     bool analyseSegmentsTulip(Communicator *communicator, std::set<double> &radiusSet, bool selOnly,
                               int tulipBins, int weightedMeasureCol, RadiusType radiusType,
                               bool choice, int weightedMeasureCol2 = -1, int routeweightCol = -1,
-                              bool interactive = false, bool forceLegacyColumnOrder = false);
+                              bool interactive = false, bool forceLegacyColumnOrder = false,
+                              bool binQueue = false, size_t threadCount = 1,
+                              size_t publishInterval = SegmentTulipBins::DEFAULT_PUBLISH_INTERVAL);
     bool analyseSegmentsAngular(Communicator *communicator, std::set<double> radiusSet);
+    // an analysis for every one of the radii, or with singlePass all the radii from a single
+    // engine, sharing the origins out among threadCount threads (0 for all the hardware threads)
     bool analyseTopoMetMultipleRadii(Communicator *communicator, std::set<double> &radiusSet,
-                                     AnalysisType outputType, double radius, bool selOnly);
+                                     AnalysisType outputType, double radius, bool selOnly,
+                                     bool singlePass = false, size_t threadCount = 1);
     bool analyseTopoMet(Communicator *communicator, AnalysisType outputType, double radius,
                         bool selOnly);
+    // segment choice estimated from a sample of origins, either a fixed number of them or as
+    // many as needed to bring the relative error of the busier segments under the target, shared
+    // out among threadCount threads (0 for all the hardware threads). The radius is metric except
+    // for tulip paths, where radiusType gives its kind
+    bool analyseSegmentChoiceSampled(Communicator *communicator,
+                                     SegmentChoiceSampled::Search search, double radius,
+                                     int tulipBins, RadiusType radiusType, size_t sampleCount,
+                                     double targetError, size_t threadCount = 1);
     //
     bool hasAllLineMap() { return m_allLineMapData.has_value(); }
     bool hasFewestLineMaps() {
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "metricbucketsearch.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // enough buckets for the costliest step from any cell to stay ahead of the current bucket
+    size_t getRingSize(double longestLink, double bucketWidth,
+                       const std::vector<double> *mergeCosts) {
+        double longestStep = longestLink;
+        if (mergeCosts != nullptr && !mergeCosts->empty()) {
+            longestStep =
+                std::max(longestStep, *std::max_element(mergeCosts->begin(), mergeCosts->end()));
+        }
+        return static_cast<size_t>(longestStep / bucketWidth) + 2;
+    }
+} // namespace
+
+MetricBucketSearch::LinkLengths
+MetricBucketSearch::getLinkLengths(const LatticeGraphCSR &graph,
+                                   const std::vector<Point2f> &locations) {
+    LinkLengths lengths;
+    double shortest = std::numeric_limits<double>::infinity();
+    double longest = 0.0;
+    for (uint32_t cell = 0; cell < graph.getCellCount(); cell++) {
+        for (auto it = graph.neighboursBegin(cell); it != graph.neighboursEnd(cell); ++it) {
+            double length = VGAGeometry::distance(locations[cell], locations[*it]);
+            shortest = std::min(shortest, length);
+            longest = std::max(longest, length);
+        }
+    }
+    if (longest > 0.0) {
+        lengths.shortest = shortest;
+        lengths.longest = longest;
+    }
+    return lengths;
+}
+
+MetricBucketSearch::MetricBucketSearch(const LatticeGraphCSR &graph,
+                                       const std::vector<Point2f> &locations,
+                                       const LinkLengths &linkLengths,
+                                       const std::vector<double> *mergeCosts)
+    : m_graph(graph), m_locations(locations),
+      // a little narrower than the shortest link, so that rounding can never keep the end of a
+      // link in the bucket it starts from
+      m_bucketWidth(linkLengths.shortest * (1.0 - 1e-6)), m_mergeCosts(mergeCosts),
+      m_buckets(getRingSize(linkLengths.longest, m_bucketWidth, mergeCosts)),
+      m_reachedIn(graph.getCellCount(), 0), m_settledIn(graph.getCellCount(), 0),
+      m_dist(graph.getCellCount(), 0.0), m_cumAngle(graph.getCellCount(), 0.0),
+      m_parent(graph.getCellCount(), LatticeGraphCSR::NO_CELL) {}
+
+void MetricBucketSearch::startRun() {
+    m_run++;
+    if (m_run == 0) {
+        // the stamps have wrapped around
+        std::fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+        std::fill(m_settledIn.begin(), m_settledIn.end(), 0);
+        m_run = 1;
+    }
+}
+
+void MetricBucketSearch::relax(uint32_t cell, double dist, uint32_t from, double cumAngle,
+                               double maxDistance, size_t &queued) {
+    if (dist > maxDistance) {
+        return;
+    }
+    if (m_reachedIn[cell] != m_run || dist < m_dist[cell]) {
+        m_reachedIn[cell] = m_run;
+        m_dist[cell] = dist;
+        m_parent[cell] = from;
+        m_cumAngle[cell] = cumAngle;
+        m_buckets[getBucket(dist) % m_buckets.size()].push_back(cell);
+        queued++;
+    }
+}
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Shortest-path search over a LatticeGraphCSR with a bucket queue in place of
+// a binary heap. Link lengths are distances between cell centres, so no link
+// is shorter than the closest pair of linked cells. With buckets narrower
+// than that, a link always leads to a later bucket than the one it starts
+// from, and once the merged cells have been brought in, every cell taken out
+// of the current bucket is final in whatever order they come out. Merge links
+// cost nothing unless given costs of their own. The buckets are a ring just
+// wide enough for the costliest step, and the per-cell state is stamped with
+// the run it belongs to, so that one search can be reused for every origin
+// without clearing
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+#include "vgageometry.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class MetricBucketSearch {
+  public:
+    struct LinkLengths {
+        double shortest = 1.0;
+        double longest = 1.0;
+    };
+    static LinkLengths getLinkLengths(const LatticeGraphCSR &graph,
+                                      const std::vector<Point2f> &locations);
+
+  private:
+    const LatticeGraphCSR &m_graph;
+    const std::vector<Point2f> &m_locations;
+    double m_bucketWidth;
+    const std::vector<double> *m_mergeCosts;
+    std::vector<std::vector<uint32_t>> m_buckets;
+    std::vector<uint32_t> m_reachedIn; // the run that last reached / settled every cell
+    std::vector<uint32_t> m_settledIn;
+    std::vector<double> m_dist;
+    std::vector<double> m_cumAngle;
+    std::vector<uint32_t> m_parent;
+    uint32_t m_run = 0;
+
+    size_t getBucket(double dist) const { return static_cast<size_t>(dist / m_bucketWidth); }
+    double getMergeCost(uint32_t cell) const {
+        return m_mergeCosts == nullptr ? 0.0 : (*m_mergeCosts)[cell];
+    }
+    void startRun();
+    void relax(uint32_t cell, double dist, uint32_t from, double cumAngle, double maxDistance,
+               size_t &queued);
+
+  public:
+    // mergeCosts, if given, has the cost of going over the merge link of every cell (0 or more)
+    MetricBucketSearch(const LatticeGraphCSR &graph, const std::vector<Point2f> &locations,
+                       const LinkLengths &linkLengths,
+                       const std::vector<double> *mergeCosts = nullptr);
+
+    // Settles every cell within maxDistance of the nearest source in order of distance, and
+    // calls settle(cell, distance, cumulativeAngle) for each, the angle being the sum of the
+    // turns along the shortest path, as in the metric analyses
+    template <typename Settle>
+    void run(const std::vector<uint32_t> &sources, double maxDistance, Settle &&settle);
+};
+
+template <typename Settle>
+void MetricBucketSearch::run(const std::vector<uint32_t> &sources, double maxDistance,
+                             Settle &&settle) {
+    startRun();
+    size_t queued = 0;
+    for (uint32_t source : sources) {
+        relax(source, 0.0, LatticeGraphCSR::NO_CELL, 0.0, maxDistance, queued);
+    }
+    for (size_t bucket = 0; queued > 0; bucket++) {
+        auto &entries = m_buckets[bucket % m_buckets.size()];
+        // the merged cells go in first, as they could otherwise improve cells already taken out
+        for (size_t i = 0; i < entries.size(); i++) {
+            uint32_t cell = entries[i];
+            uint32_t merge = m_graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL && m_settledIn[cell] != m_run &&
+                getBucket(m_dist[cell]) == bucket) {
+                relax(merge, m_dist[cell] + getMergeCost(cell), LatticeGraphCSR::NO_CELL,
+                      m_cumAngle[cell], maxDistance, queued);
+            }
+        }
+        while (!entries.empty()) {
+            uint32_t cell = entries.back();
+            entries.pop_back();
+            queued--;
+            // a cell is left behind in the bucket it was in before it got closer
+            if (m_settledIn[cell] == m_run || getBucket(m_dist[cell]) != bucket) {
+                continue;
+            }
+            m_settledIn[cell] = m_run;
+            const double cellDist = m_dist[cell];
+            const double cellAngle = m_cumAngle[cell];
+            settle(cell, cellDist, cellAngle);
+
+            const uint32_t parent = m_parent[cell];
+            for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell); ++it) {
+                if (m_settledIn[*it] == m_run) {
+                    continue;
+                }
+                double turn = parent == LatticeGraphCSR::NO_CELL
+                                  ? 0.0
+                                  : VGAGeometry::turnAngle(m_locations[parent],
+                                                           m_locations[cell], m_locations[*it]);
+                relax(*it, cellDist + VGAGeometry::distance(m_locations[cell], m_locations[*it]),
+                      cell, cellAngle + turn, maxDistance, queued);
+            }
+        }
+    }
+}
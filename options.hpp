@@ -40,11 +40,34 @@ struct Options {
     int weightedMeasureCol2; // EFEF
     int routeweightCol;      // EFEF
     std::string outputFile;  // To save an output graph (for example)
+    // VGA: local, global (and isovist) measures in a single pass
+    bool fusedVisual;
+    bool fusedIsovist;
+    // VGA: visual global and step depth with the bitmap frontier search
+    bool bitmapFrontier;
+    // VGA: estimate mean depth from a sample of pivot origins, either a fixed number of them or
+    // as many as needed to bring the relative 95% interval under the target error
+    int samplePivots;
+    double sampleTargetError;
+    // VGA: after edits, only analyse again the origins that the changes can reach (fused visual
+    // analysis without isovists)
+    bool incremental;
+    // VGA: metric analysis and metric step depth with the bucket queue search
+    bool bucketMetric;
+    // VGA: angular analysis and angular step depth with the bucketed least-angle search
+    bool bucketAngular;
+    // Segments: tulip analysis with the bin queue search (without weights or choice)
+    bool tulipBinQueue;
+    // for the engines that share the work out among threads (0 for all the hardware threads)
+    int threadCount;
     // default values
     Options()
         : outputType(AnalysisType::ISOVIST), local(0), global(1), cliques(0), choice(false),
           fulloutput(false), radiusType(RadiusType::TOPOLOGICAL), radius(-1), radiusSet(),
           pointDepthSelection(0), tulipBins(1024), processInMemory(false), selOnly(false),
           gatesOnly(false), gatelayer(-1), weightedMeasureCol(-1), weightedMeasureCol2(-1),
-          routeweightCol(-1), outputFile() {}
+          routeweightCol(-1), outputFile(), fusedVisual(false), fusedIsovist(false),
+          bitmapFrontier(false), samplePivots(0), sampleTargetError(0.0),
+          incremental(false), bucketMetric(false), bucketAngular(false), tulipBinQueue(false),
+          threadCount(1) {}
 };
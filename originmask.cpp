@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "originmask.hpp"
+
+OriginMask::OriginMask(const ShapeGraphCSR &graph, const std::set<int> &refs)
+    : m_words((graph.getLineCount() + 63) / 64, 0) {
+    for (int ref : refs) {
+        uint32_t line = graph.getLine(ref);
+        if (line != ShapeGraphCSR::NO_LINE && !contains(line)) {
+            m_words[line / 64] |= uint64_t(1) << (line % 64);
+            m_count++;
+        }
+    }
+}
+
+std::vector<uint32_t> OriginMask::getLines() const {
+    std::vector<uint32_t> lines;
+    lines.reserve(m_count);
+    for (size_t word = 0; word < m_words.size(); word++) {
+        // empty words are passed over whole, the rest up to their last line
+        uint64_t bits = m_words[word];
+        for (uint32_t bit = 0; bits != 0; bit++, bits >>= 1) {
+            if ((bits & 1) != 0) {
+                lines.push_back(static_cast<uint32_t>(word * 64 + bit));
+            }
+        }
+    }
+    return lines;
+}
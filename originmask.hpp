@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The origins of an analysis restricted to a selection, as a bitmap over the
+// lines of a ShapeGraphCSR. It is made once from the selected shape keys and
+// only read after that, so that all the workers of an analysis can test it at
+// once, a bit per line and without going through the keys
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+class OriginMask {
+    std::vector<uint64_t> m_words;
+    size_t m_count = 0;
+
+  public:
+    // keys of shapes not in the graph are left out
+    OriginMask(const ShapeGraphCSR &graph, const std::set<int> &refs);
+
+    bool contains(uint32_t line) const { return (m_words[line / 64] >> (line % 64)) & 1; }
+    size_t count() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    // the lines in the mask, in order
+    std::vector<uint32_t> getLines() const;
+};
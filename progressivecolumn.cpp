@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "progressivecolumn.hpp"
+
+#include <cmath>
+#include <limits>
+
+ProgressiveColumn::ProgressiveColumn(std::string name, std::vector<int> refs,
+                                     std::vector<uint32_t> cells, size_t cellCount)
+    : m_name(std::move(name)), m_refs(std::move(refs)), m_cells(std::move(cells)) {
+    m_cells.resize(m_refs.size(), NO_CELL);
+    for (auto &buffer : m_buffers) {
+        buffer.values.assign(m_refs.size(), std::numeric_limits<float>::quiet_NaN());
+        buffer.cellMeans.assign(cellCount, -1.0f);
+    }
+}
+
+void ProgressiveColumn::setValue(size_t row, float value) {
+    getBackBuffer().values[row] = value;
+    m_setRows.push_back(row);
+}
+
+void ProgressiveColumn::publish(double completion) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_front = 1 - m_front;
+        m_generation++;
+        m_completion = completion;
+    }
+    // the front buffer is only ever read, so the new back one can catch up with it unlocked
+    const auto &front = m_buffers[m_front];
+    auto &back = getBackBuffer();
+    for (size_t row : m_setRows) {
+        back.values[row] = front.values[row];
+    }
+    m_setRows.clear();
+    back.cellMeans = front.cellMeans;
+    back.mean = front.mean;
+}
+
+size_t ProgressiveColumn::copyFront(std::vector<float> &values, double *completion) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto &front = m_buffers[m_front];
+    values.resize(m_refs.size());
+    for (size_t row = 0; row < m_refs.size(); row++) {
+        float value = front.values[row];
+        if (std::isnan(value)) {
+            const uint32_t cell = m_cells[row];
+            if (cell == NO_CELL) {
+                value = -1.0f;
+            } else {
+                value = front.cellMeans[cell] >= 0.0f ? front.cellMeans[cell] : front.mean;
+            }
+        }
+        values[row] = value;
+    }
+    if (completion != nullptr) {
+        *completion = m_completion;
+    }
+    return m_generation;
+}
+
+size_t ProgressiveColumn::getGeneration() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The values of a column while an analysis is still working them out, for
+// the renderer to show before they reach the attribute table. There are two
+// buffers: the analysis writes into the back one at its own pace, and then
+// publishes it, which swaps it with the front one. The renderer only ever
+// copies the front one out, so a partial set of values is never seen half
+// written, and neither side waits for more than the swap. The rows not set
+// yet can be given a cell, and then show the mean the analysis gives for the
+// cell, or for all the rows while the cell has none. The means are put in
+// as the front buffer is copied out, so that a publish only costs as much as
+// the rows set since the last one and the cells
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ProgressiveColumn {
+  public:
+    static constexpr uint32_t NO_CELL = static_cast<uint32_t>(-1);
+
+  private:
+    struct Buffer {
+        std::vector<float> values;    // row -> value, NaN until set
+        std::vector<float> cellMeans; // -1 for cells without a mean
+        float mean = -1.0f;
+    };
+
+    std::string m_name;
+    std::vector<int> m_refs;       // row -> shape key
+    std::vector<uint32_t> m_cells; // row -> cell, NO_CELL for rows that stay at -1 until set
+    Buffer m_buffers[2];
+    // the rows set in the back buffer since the last publish, which the other buffer still lacks
+    std::vector<size_t> m_setRows;
+    mutable std::mutex m_mutex;
+    size_t m_front = 0;
+    size_t m_generation = 0; // the number of times the values have been published
+    double m_completion = 0.0;
+
+    Buffer &getBackBuffer() { return m_buffers[1 - m_front]; }
+
+  public:
+    // All the values start as -1 (no value). The rows can be given a cell each (NO_CELL for
+    // none) out of cellCount, and then show its mean until set
+    ProgressiveColumn(std::string name, std::vector<int> refs, std::vector<uint32_t> cells = {},
+                      size_t cellCount = 0);
+
+    const std::string &getName() const { return m_name; }
+    const std::vector<int> &getRefs() const { return m_refs; }
+    size_t getCellCount() const { return m_buffers[0].cellMeans.size(); }
+
+    // the rest only for the analysis:
+
+    // into the back buffer
+    void setValue(size_t row, float value);
+    void setCellMean(uint32_t cell, float mean) { getBackBuffer().cellMeans[cell] = mean; }
+    void setMean(float mean) { getBackBuffer().mean = mean; }
+    // shows the values of the back buffer, completion being the part of the analysis done
+    void publish(double completion);
+
+    // the values last published in the order of the refs, along with the part of the analysis
+    // that was done then. Returns the generation of the values, 0 if none have been published
+    size_t copyFront(std::vector<float> &values, double *completion = nullptr) const;
+    size_t getGeneration() const;
+};
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "routegraph.hpp"
+
+#include <cstring>
+
+namespace {
+    void combine(uint64_t &hash, uint64_t value) {
+        // as boost::hash_combine, widened to 64 bits
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 12) + (hash >> 4);
+    }
+
+    uint64_t getBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+} // namespace
+
+uint64_t RouteGraph::getFingerprint(const ShapeGraph &map) {
+    const auto &shapes = map.getAllShapes();
+    const auto &connectors = map.getConnections();
+    const size_t lineCount = std::min(shapes.size(), connectors.size());
+    uint64_t hash = 0;
+    combine(hash, lineCount);
+    auto shapeIt = shapes.begin();
+    for (size_t line = 0; line < lineCount; line++, ++shapeIt) {
+        combine(hash, static_cast<uint64_t>(shapeIt->first));
+        // the lengths as they are kept in the graph
+        combine(hash, getBits(static_cast<float>(shapeIt->second.getLength())));
+        const auto &connector = connectors[line];
+        combine(hash, connector.connections.size());
+        for (size_t other : connector.connections) {
+            combine(hash, other);
+        }
+        combine(hash, static_cast<uint64_t>(connector.segmentAxialref));
+        for (const auto *segconns : {&connector.backSegconns, &connector.forwardSegconns}) {
+            combine(hash, segconns->size());
+            for (const auto &segconn : *segconns) {
+                combine(hash, static_cast<uint64_t>(segconn.first.ref));
+                combine(hash, static_cast<uint64_t>(segconn.first.dir));
+                combine(hash, getBits(segconn.second));
+            }
+        }
+    }
+    return hash;
+}
+
+RouteGraph::RouteGraph(ShapeGraph &map, size_t revision)
+    : m_graph(map), m_fingerprint(getFingerprint(map)), m_revision(revision) {}
+
+RouteSearch &RouteGraph::getSearch(RouteSearch::Cost cost) {
+    auto &search = m_searches[static_cast<size_t>(cost)];
+    if (!search) {
+        search = std::make_unique<RouteSearch>(m_graph, cost);
+    }
+    return *search;
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The graph of an axial or segment map as the route and catchment queries go
+// over it, kept on the map from one query to the next along with a
+// RouteSearch for every cost, so that a query only goes over the lines it
+// reaches and has nothing to allocate. It is only made again when the map has
+// been edited since the last query and a fingerprint of the shapes and their
+// connections shows that the edits changed the graph
+
+#pragma once
+
+#include "routesearch.hpp"
+#include "shapegraphcsr.hpp"
+
+#include "salalib/shapegraph.hpp"
+
+#include <cstdint>
+#include <memory>
+
+class RouteGraph {
+    ShapeGraphCSR m_graph;
+    uint64_t m_fingerprint;
+    size_t m_revision; // of the map when it was last found to match
+    // by cost, each made the first time it is asked for
+    std::unique_ptr<RouteSearch> m_searches[3];
+
+  public:
+    // of the shapes, their lengths and their connections, as the graph is made from them
+    static uint64_t getFingerprint(const ShapeGraph &map);
+
+    RouteGraph(ShapeGraph &map, size_t revision);
+    // the searches hold on to the graph
+    RouteGraph(const RouteGraph &) = delete;
+    RouteGraph &operator=(const RouteGraph &) = delete;
+
+    bool matches(const ShapeGraph &map) const { return getFingerprint(map) == m_fingerprint; }
+    size_t getRevision() const { return m_revision; }
+    void setRevision(size_t revision) { m_revision = revision; }
+
+    const ShapeGraphCSR &getGraph() const { return m_graph; }
+    RouteSearch &getSearch(RouteSearch::Cost cost);
+};
@@ -0,0 +1,253 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "routesearch.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+    std::pair<double, double> add(const std::pair<double, double> &a,
+                                  const std::pair<double, double> &b) {
+        return {a.first + b.first, a.second + b.second};
+    }
+} // namespace
+
+RouteSearch::RouteSearch(const ShapeGraphCSR &graph, Cost cost)
+    : m_graph(graph), m_cost(cost), m_overStates(cost == Cost::ANGULAR) {
+    const size_t nodeCount = m_overStates ? graph.getStateCount() : graph.getLineCount();
+    for (auto &side : m_sides) {
+        side.reachedIn.assign(nodeCount, 0);
+        side.settledIn.assign(nodeCount, 0);
+        side.depth.resize(nodeCount);
+        side.parent.assign(nodeCount, ShapeGraphCSR::NO_LINE);
+    }
+    if (m_overStates) {
+        m_lineSettledIn.assign(graph.getLineCount(), 0);
+    }
+}
+
+void RouteSearch::startRun() {
+    m_run++;
+    if (m_run == 0) {
+        // the stamps have wrapped around
+        for (auto &side : m_sides) {
+            std::fill(side.reachedIn.begin(), side.reachedIn.end(), 0);
+            std::fill(side.settledIn.begin(), side.settledIn.end(), 0);
+        }
+        std::fill(m_lineSettledIn.begin(), m_lineSettledIn.end(), 0);
+        m_run = 1;
+    }
+    for (auto &side : m_sides) {
+        side.heap.clear();
+    }
+}
+
+template <typename Visit>
+void RouteSearch::forEachLink(uint32_t node, Visit visit) const {
+    if (m_overStates) {
+        const uint32_t line = ShapeGraphCSR::getStateLine(node);
+        for (uint32_t link = m_graph.getStateLinkOffset(node); link < m_graph.getStateLinkEnd(node);
+             link++) {
+            const uint32_t next = m_graph.getStateLink(link);
+            const uint32_t nextLine = ShapeGraphCSR::getStateLine(next);
+            visit(next, Depth(m_graph.getStateWeight(link),
+                              (m_graph.getLength(line) + m_graph.getLength(nextLine)) * 0.5));
+        }
+        return;
+    }
+    const double halfLength = m_graph.getLength(node) * 0.5;
+    auto visitLine = [&](uint32_t next) {
+        const double dist = halfLength + m_graph.getLength(next) * 0.5;
+        if (m_cost != Cost::TOPOLOGICAL) {
+            visit(next, Depth(dist, dist));
+        } else if (m_graph.hasStates()) {
+            visit(next, Depth(m_graph.getAxialRef(next) != m_graph.getAxialRef(node) ? 1.0 : 0.0,
+                              dist));
+        } else {
+            visit(next, Depth(1.0, dist));
+        }
+    };
+    if (!m_graph.hasStates()) {
+        for (auto it = m_graph.connectionsBegin(node); it != m_graph.connectionsEnd(node); ++it) {
+            visitLine(*it);
+        }
+        return;
+    }
+    // the segment is connected at either end, whichever way the search came along it
+    for (bool forwards : {false, true}) {
+        const uint32_t state = ShapeGraphCSR::getState(node, forwards);
+        for (uint32_t link = m_graph.getStateLinkOffset(state);
+             link < m_graph.getStateLinkEnd(state); link++) {
+            const uint32_t next = ShapeGraphCSR::getStateLine(m_graph.getStateLink(link));
+            if (next != node) {
+                visitLine(next);
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> RouteSearch::run(uint32_t from, uint32_t to) {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    m_routeDepth = Depth(inf, inf);
+    const size_t lineCount = m_graph.getLineCount();
+    if (!isValid() || from >= lineCount || to >= lineCount) {
+        return {};
+    }
+    if (from == to) {
+        m_routeDepth = Depth(0.0, 0.0);
+        return {from};
+    }
+
+    startRun();
+    const uint32_t ends[2] = {from, to};
+    for (size_t s = 0; s < 2; s++) {
+        auto &side = m_sides[s];
+        auto seed = [&](uint32_t node) {
+            side.reachedIn[node] = m_run;
+            side.depth[node] = Depth(0.0, 0.0);
+            side.parent[node] = ShapeGraphCSR::NO_LINE;
+            side.heap.emplace_back(Depth(0.0, 0.0), node);
+        };
+        if (m_overStates) {
+            seed(ShapeGraphCSR::getState(ends[s], false));
+            seed(ShapeGraphCSR::getState(ends[s], true));
+        } else {
+            seed(ends[s]);
+        }
+    }
+
+    Depth best(inf, inf);
+    uint32_t meeting = ShapeGraphCSR::NO_LINE; // as the search from the start reaches it
+    while (!m_sides[0].heap.empty() && !m_sides[1].heap.empty()) {
+        // no route through the lines still to be settled could be any shorter
+        const Depth &nearest0 = m_sides[0].heap.front().first;
+        const Depth &nearest1 = m_sides[1].heap.front().first;
+        if (!(add(nearest0, nearest1) < best)) {
+            break;
+        }
+        // the side with the nearer line goes on
+        const size_t s = nearest1 < nearest0 ? 1 : 0;
+        auto &side = m_sides[s];
+        const auto &other = m_sides[1 - s];
+        std::pop_heap(side.heap.begin(), side.heap.end(), std::greater<Entry>());
+        const Depth depth = side.heap.back().first;
+        const uint32_t node = side.heap.back().second;
+        side.heap.pop_back();
+        if (side.settledIn[node] == m_run) {
+            continue;
+        }
+        side.settledIn[node] = m_run;
+
+        forEachLink(node, [&](uint32_t next, const Depth &cost) {
+            if (side.settledIn[next] == m_run) {
+                return;
+            }
+            const Depth nextDepth = add(depth, cost);
+            if (side.reachedIn[next] == m_run && !(nextDepth < side.depth[next])) {
+                return;
+            }
+            side.reachedIn[next] = m_run;
+            side.depth[next] = nextDepth;
+            side.parent[next] = node;
+            side.heap.emplace_back(nextDepth, next);
+            std::push_heap(side.heap.begin(), side.heap.end(), std::greater<Entry>());
+
+            const uint32_t otherNode = getMeetingNode(next);
+            if (other.reachedIn[otherNode] == m_run) {
+                const Depth total = add(nextDepth, other.depth[otherNode]);
+                if (total < best) {
+                    best = total;
+                    meeting = s == 0 ? next : otherNode;
+                }
+            }
+        });
+    }
+    if (meeting == ShapeGraphCSR::NO_LINE) {
+        return {};
+    }
+    m_routeDepth = best;
+
+    // back from where the two met to the start, then on from there to the end
+    std::vector<uint32_t> nodes;
+    for (uint32_t node = meeting; node != ShapeGraphCSR::NO_LINE; node = m_sides[0].parent[node]) {
+        nodes.push_back(node);
+    }
+    std::reverse(nodes.begin(), nodes.end());
+    for (uint32_t node = m_sides[1].parent[getMeetingNode(meeting)];
+         node != ShapeGraphCSR::NO_LINE; node = m_sides[1].parent[node]) {
+        nodes.push_back(node);
+    }
+    std::vector<uint32_t> route;
+    for (uint32_t node : nodes) {
+        const uint32_t line = m_overStates ? ShapeGraphCSR::getStateLine(node) : node;
+        if (route.empty() || route.back() != line) {
+            route.push_back(line);
+        }
+    }
+    return route;
+}
+
+std::vector<std::pair<uint32_t, double>>
+RouteSearch::getCatchment(const std::vector<uint32_t> &origins, double limit) {
+    std::vector<std::pair<uint32_t, double>> catchment;
+    if (!isValid()) {
+        return catchment;
+    }
+    startRun();
+    auto &side = m_sides[0];
+    auto seed = [&](uint32_t node) {
+        side.reachedIn[node] = m_run;
+        side.depth[node] = Depth(0.0, 0.0);
+        side.parent[node] = ShapeGraphCSR::NO_LINE;
+        side.heap.emplace_back(Depth(0.0, 0.0), node);
+    };
+    for (uint32_t origin : origins) {
+        if (origin >= m_graph.getLineCount()) {
+            continue;
+        }
+        if (m_overStates) {
+            seed(ShapeGraphCSR::getState(origin, false));
+            seed(ShapeGraphCSR::getState(origin, true));
+        } else {
+            seed(origin);
+        }
+    }
+    std::make_heap(side.heap.begin(), side.heap.end(), std::greater<Entry>());
+
+    while (!side.heap.empty()) {
+        std::pop_heap(side.heap.begin(), side.heap.end(), std::greater<Entry>());
+        const Depth depth = side.heap.back().first;
+        const uint32_t node = side.heap.back().second;
+        side.heap.pop_back();
+        if (side.settledIn[node] == m_run) {
+            continue;
+        }
+        side.settledIn[node] = m_run;
+        if (!m_overStates) {
+            catchment.emplace_back(node, depth.first);
+        } else if (m_lineSettledIn[ShapeGraphCSR::getStateLine(node)] != m_run) {
+            m_lineSettledIn[ShapeGraphCSR::getStateLine(node)] = m_run;
+            catchment.emplace_back(ShapeGraphCSR::getStateLine(node), depth.first);
+        }
+
+        forEachLink(node, [&](uint32_t next, const Depth &cost) {
+            if (side.settledIn[next] == m_run) {
+                return;
+            }
+            const Depth nextDepth = add(depth, cost);
+            if (nextDepth.first > limit ||
+                (side.reachedIn[next] == m_run && !(nextDepth < side.depth[next]))) {
+                return;
+            }
+            side.reachedIn[next] = m_run;
+            side.depth[next] = nextDepth;
+            side.parent[next] = node;
+            side.heap.emplace_back(nextDepth, next);
+            std::push_heap(side.heap.begin(), side.heap.end(), std::greater<Entry>());
+        });
+    }
+    return catchment;
+}
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The least cost route between two lines of a ShapeGraphCSR, from a search
+// out of either end at once that stops as soon as no route through the lines
+// still to be settled could be shorter than the best one where the two have
+// met. Metric routes go from the middle of one line to the middle of the
+// next (as SegmentDepthSearch), angular routes through the turns between the
+// segments of a segment map (1 for a right angle) and topological ones
+// through the changes of axial line of a segment map or the steps between
+// the lines of an axial map, the last two with the metric distance to break
+// ties. The links of the graphs made from ShapeGraphs cost the same either
+// way, so the search from the end goes over the same links as the one from
+// the start, with the segments turned around. The same costs give the lines
+// within a limit of a set of origins, from the search out of the origins
+// alone. The state of every line is stamped with the search it belongs to, so
+// that one RouteSearch can be kept for many routes without clearing it in
+// between
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class RouteSearch {
+  public:
+    enum class Cost { METRIC, ANGULAR, TOPOLOGICAL };
+
+  private:
+    // the cost, then the metric distance to break ties
+    using Depth = std::pair<double, double>;
+    using Entry = std::pair<Depth, uint32_t>;
+
+    // the search out of one end, over lines, or the states of the segments for angular routes
+    struct Side {
+        std::vector<uint32_t> reachedIn;
+        std::vector<uint32_t> settledIn;
+        std::vector<Depth> depth;
+        std::vector<uint32_t> parent;
+        std::vector<Entry> heap;
+    };
+
+    const ShapeGraphCSR &m_graph;
+    Cost m_cost;
+    bool m_overStates;
+    Side m_sides[2];
+    // for catchments over the states of the segments, the first of which to be settled is the
+    // nearer one
+    std::vector<uint32_t> m_lineSettledIn;
+    uint32_t m_run = 0;
+    Depth m_routeDepth;
+
+    void startRun();
+    // the node the other side reaches a node as
+    uint32_t getMeetingNode(uint32_t node) const { return m_overStates ? node ^ 1 : node; }
+    template <typename Visit>
+    void forEachLink(uint32_t node, Visit visit) const;
+
+  public:
+    RouteSearch(const ShapeGraphCSR &graph, Cost cost);
+
+    // false for angular routes on axial maps, which have no turns to go through
+    bool isValid() const { return !m_overStates || m_graph.hasStates(); }
+
+    // the lines from one to the other, empty if there is no route between them
+    std::vector<uint32_t> run(uint32_t from, uint32_t to);
+    // of the last route
+    double getCost() const { return m_routeDepth.first; }
+    double getDistance() const { return m_routeDepth.second; }
+
+    // the lines whose least cost from any of the origins is within limit, each with that cost,
+    // in order of it. The search goes no further than the limit
+    std::vector<std::pair<uint32_t, double>> getCatchment(const std::vector<uint32_t> &origins,
+                                                          double limit);
+};
@@ -0,0 +1,228 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "segmentchoicesampled.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "segmentdepthsearch.hpp"
+#include "tulipbinsearch.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/segmmodules/segmmetric.hpp"
+#include "salalib/segmmodules/segmtopological.hpp"
+#include "salalib/segmmodules/segmtulip.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+
+namespace {
+    // the scratch space of a worker, kept from one batch to the next
+    struct Arena {
+        std::unique_ptr<TulipBinSearch> tulipSearch;
+        std::unique_ptr<SegmentDepthSearch> depthSearch;
+        std::vector<uint32_t> order; // of the tulip search, as it only hands the lines out
+        std::vector<uint32_t> below; // segments under every segment of the tree of the origin
+        // the paths through every segment from the sampled origins, and their squares, which
+        // could go past 64 bits on the largest maps so are only kept to the precision of a double
+        std::vector<uint64_t> sum;
+        std::vector<double> sumSquares;
+    };
+
+    struct Estimate {
+        double choice = -1.0;
+        double variance = -1.0;
+    };
+
+    Estimate estimate(uint64_t sum, double sumSquares, size_t samplesUsed, size_t lineCount) {
+        Estimate result;
+        if (samplesUsed == 0) {
+            return result;
+        }
+        auto samples = static_cast<double>(samplesUsed);
+        auto population = static_cast<double>(lineCount);
+        double mean = static_cast<double>(sum) / samples;
+        result.choice = mean * population;
+        if (samplesUsed > 1) {
+            double sampleVariance =
+                std::max(0.0, (sumSquares - static_cast<double>(sum) * mean) / (samples - 1.0));
+            // finite population correction, which goes to zero when every segment is an origin
+            double correction = std::max(0.0, (population - samples) / population);
+            result.variance = population * population * sampleVariance / samples * correction;
+        }
+        return result;
+    }
+} // namespace
+
+std::string SegmentChoiceSampled::getChoiceColumn() const {
+    switch (m_search) {
+    case Search::TULIP:
+        return SegmentTulip::getFormattedColumn(SegmentTulip::Column::CHOICE, m_tulipBins,
+                                                m_radiusType, m_radius);
+    case Search::TOPOLOGICAL:
+        return SegmentTopological::getFormattedColumn(
+            SegmentTopological::Column::TOPOLOGICAL_CHOICE, m_radius);
+    case Search::METRIC:
+        break;
+    }
+    return SegmentMetric::getFormattedColumn(SegmentMetric::Column::METRIC_CHOICE, m_radius);
+}
+
+bool SegmentChoiceSampled::run(Communicator *comm) {
+    const size_t lineCount = m_graph.getLineCount();
+    if (lineCount < 3 || !m_graph.hasStates() || (m_sampleCount == 0 && m_targetError <= 0.0) ||
+        (m_search == Search::TULIP && m_tulipBins < 4)) {
+        return false;
+    }
+
+    // origins are taken from a shuffled order, i.e. sampled without replacement
+    std::vector<uint32_t> sampleOrder(lineCount);
+    std::iota(sampleOrder.begin(), sampleOrder.end(), 0);
+    std::mt19937 generator(m_seed);
+    std::shuffle(sampleOrder.begin(), sampleOrder.end(), generator);
+
+    std::vector<uint32_t> costs;
+    double tulipLimit = std::numeric_limits<double>::infinity();
+    if (m_search == Search::TULIP) {
+        costs = TulipBinSearch::getLinkCosts(m_graph, m_tulipBins);
+        if (m_radius >= 0) {
+            tulipLimit = m_radiusType == RadiusType::ANGULAR
+                             ? m_radius * TulipBinSearch::getBinsPerRightAngle(m_tulipBins)
+                             : m_radius;
+        }
+    }
+    const double limit = m_radius < 0 ? std::numeric_limits<double>::infinity() : m_radius;
+
+    WorkStealingPool pool(m_threadCount);
+    std::vector<Arena> arenas(pool.getThreadCount());
+
+    // the paths through every segment from one origin go to the sums of the worker
+    auto sample = [&](uint32_t origin, size_t worker) {
+        auto &arena = arenas[worker];
+        if (arena.sum.empty()) {
+            if (m_search == Search::TULIP) {
+                arena.tulipSearch = std::make_unique<TulipBinSearch>(m_graph, costs);
+                arena.order.reserve(lineCount);
+            } else {
+                arena.depthSearch = std::make_unique<SegmentDepthSearch>(
+                    m_graph, m_search == Search::TOPOLOGICAL);
+            }
+            arena.below.resize(lineCount);
+            arena.sum.assign(lineCount, 0);
+            arena.sumSquares.assign(lineCount, 0.0);
+        }
+        const std::vector<uint32_t> *order = &arena.order;
+        if (arena.tulipSearch) {
+            arena.order.clear();
+            arena.tulipSearch->run(origin, m_radiusType, tulipLimit,
+                                   [&](uint32_t line, uint32_t) { arena.order.push_back(line); });
+        } else {
+            arena.depthSearch->run(origin, limit);
+            order = &arena.depthSearch->getOrder();
+        }
+        auto getParent = [&](uint32_t line) {
+            return arena.tulipSearch ? arena.tulipSearch->getParent(line)
+                                     : arena.depthSearch->getParent(line);
+        };
+
+        // every segment deeper in the tree is a path through this one from the origin, counted
+        // from the bottom of the tree up
+        for (uint32_t line : *order) {
+            arena.below[line] = 0;
+        }
+        for (size_t q = order->size(); q-- > 1;) {
+            uint32_t line = (*order)[q];
+            uint64_t paths = arena.below[line];
+            arena.sum[line] += paths;
+            arena.sumSquares[line] += static_cast<double>(paths) * static_cast<double>(paths);
+            arena.below[getParent(line)] += arena.below[line] + 1;
+        }
+    };
+
+    std::vector<uint64_t> sum(lineCount);
+    std::vector<double> sumSquares(lineCount);
+    // whole counts, so the sums are the same in any order (the squares as long as they stay
+    // within the 53 bits a double holds exactly)
+    auto gatherSums = [&]() {
+        std::fill(sum.begin(), sum.end(), 0);
+        std::fill(sumSquares.begin(), sumSquares.end(), 0.0);
+        for (const auto &arena : arenas) {
+            if (arena.sum.empty()) {
+                continue;
+            }
+            for (size_t line = 0; line < lineCount; line++) {
+                sum[line] += arena.sum[line];
+                sumSquares[line] += arena.sumSquares[line];
+            }
+        }
+    };
+
+    m_samplesUsed = 0;
+    size_t batchEnd = m_sampleCount > 0 ? std::min(m_sampleCount, lineCount)
+                                        : std::min(FIRST_BATCH, lineCount);
+    while (true) {
+        const size_t batchStart = m_samplesUsed;
+        pool.parallelFor(
+            batchEnd - batchStart,
+            [&](size_t index, size_t worker) { sample(sampleOrder[batchStart + index], worker); },
+            comm);
+        m_samplesUsed = batchEnd;
+        gatherSums();
+        if (m_sampleCount > 0 || m_samplesUsed == lineCount) {
+            break;
+        }
+
+        std::vector<Estimate> estimates(lineCount);
+        double meanChoice = 0.0;
+        for (size_t line = 0; line < lineCount; line++) {
+            estimates[line] = estimate(sum[line], sumSquares[line], m_samplesUsed, lineCount);
+            meanChoice += estimates[line].choice;
+        }
+        meanChoice /= static_cast<double>(lineCount);
+        double worstError = 0.0;
+        for (const auto &lineEstimate : estimates) {
+            if (lineEstimate.choice > 0.0 && lineEstimate.choice >= meanChoice) {
+                // not enough samples to say anything about the spread yet
+                if (lineEstimate.variance < 0.0) {
+                    worstError = std::numeric_limits<double>::infinity();
+                    break;
+                }
+                worstError =
+                    std::max(worstError, std::sqrt(lineEstimate.variance) / lineEstimate.choice);
+            }
+        }
+        if (worstError <= m_targetError) {
+            break;
+        }
+        batchEnd = std::min(batchEnd * 2, lineCount);
+    }
+
+    const std::string choiceColumn = getChoiceColumn();
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(getApproxColumn(choiceColumn));
+    transaction.insertOrResetColumn(getVarianceColumn(choiceColumn));
+    // the column order might have changed while inserting, retrieve them all again:
+    auto choiceCol = transaction.getColumnIndex(getApproxColumn(choiceColumn));
+    auto varianceCol = transaction.getColumnIndex(getVarianceColumn(choiceColumn));
+
+    for (size_t line = 0; line < lineCount; line++) {
+        AttributeRow *row =
+            attributes.getRowPtr(AttributeKey(m_graph.getRef(static_cast<uint32_t>(line))));
+        if (row == nullptr) {
+            continue;
+        }
+        Estimate lineEstimate = estimate(sum[line], sumSquares[line], m_samplesUsed, lineCount);
+        row->setValue(choiceCol, static_cast<float>(lineEstimate.choice));
+        row->setValue(varianceCol, static_cast<float>(lineEstimate.variance));
+    }
+
+    transaction.commit();
+    return true;
+}
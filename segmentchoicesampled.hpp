@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Segment choice estimated from a random sample of origins instead of all of
+// them, for the tulip, topological or metric paths. The tree of paths from a
+// sampled origin gives the number of paths through every segment, and the
+// choice of every segment is the mean of those scaled up to all the origins.
+// Every estimate is written next to its variance. The origins are either a
+// fixed number or as many as needed to bring the relative standard error of
+// the busier segments (those above the mean estimate) under a target error.
+// Every batch of origins is shared out among threads, and as the counts are
+// whole numbers the result does not depend on the number of threads
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include "salalib/radiustype.hpp"
+#include "salalib/shapegraph.hpp"
+
+#include <string>
+
+class SegmentChoiceSampled {
+  public:
+    enum class Search { TULIP, TOPOLOGICAL, METRIC };
+
+    static std::string getApproxColumn(const std::string &column) {
+        return column + " [Approx]";
+    }
+    static std::string getVarianceColumn(const std::string &column) {
+        return column + " [Approx Variance]";
+    }
+
+    // origins in the first batch when working towards a target error, doubled with every batch
+    static constexpr size_t FIRST_BATCH = 32;
+
+  private:
+    ShapeGraph &m_map;
+    const ShapeGraphCSR &m_graph;
+    Search m_search;
+    double m_radius; // -1 for radius n, metric unless given otherwise for tulip paths
+    int m_tulipBins;
+    RadiusType m_radiusType; // only for tulip paths
+    size_t m_sampleCount;    // 0 to use the target error
+    double m_targetError;    // relative to the estimate
+    size_t m_threadCount;
+    uint32_t m_seed;
+    size_t m_samplesUsed = 0;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    SegmentChoiceSampled(ShapeGraph &map, const ShapeGraphCSR &graph, Search search,
+                         double radius, int tulipBins, RadiusType radiusType, size_t sampleCount,
+                         double targetError = 0.0, size_t threadCount = 1, uint32_t seed = 0)
+        : m_map(map), m_graph(graph), m_search(search), m_radius(radius), m_tulipBins(tulipBins),
+          m_radiusType(radiusType), m_sampleCount(sampleCount), m_targetError(targetError),
+          m_threadCount(threadCount), m_seed(seed) {}
+    std::string getAnalysisName() const { return "Sampled Segment Choice"; }
+    size_t getSamplesUsed() const { return m_samplesUsed; }
+    // the exact choice column of the same paths, the estimates go next to it
+    std::string getChoiceColumn() const;
+    bool run(Communicator *comm);
+};
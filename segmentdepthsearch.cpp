@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "segmentdepthsearch.hpp"
+
+#include <algorithm>
+#include <functional>
+
+SegmentDepthSearch::SegmentDepthSearch(const ShapeGraphCSR &graph, bool topological)
+    : m_graph(graph), m_topological(topological), m_reachedIn(graph.getLineCount(), 0),
+      m_settledIn(graph.getLineCount(), 0), m_depth(graph.getLineCount(), 0.0),
+      m_dist(graph.getLineCount(), 0.0),
+      m_parent(graph.getLineCount(), ShapeGraphCSR::NO_LINE) {
+    m_order.reserve(graph.getLineCount());
+}
+
+void SegmentDepthSearch::startRun() {
+    m_run++;
+    if (m_run == 0) {
+        // the stamps have wrapped around
+        std::fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+        std::fill(m_settledIn.begin(), m_settledIn.end(), 0);
+        m_run = 1;
+    }
+}
+
+void SegmentDepthSearch::run(uint32_t origin, double limit) {
+    if (m_topological) {
+        search<true>(origin, limit);
+    } else {
+        search<false>(origin, limit);
+    }
+}
+
+template <bool topological>
+void SegmentDepthSearch::search(uint32_t origin, double limit) {
+    startRun();
+    m_heap.clear();
+    m_order.clear();
+    m_reachedIn[origin] = m_run;
+    m_depth[origin] = 0.0;
+    m_dist[origin] = 0.0;
+    m_parent[origin] = ShapeGraphCSR::NO_LINE;
+    m_heap.emplace_back(0.0, 0.0, origin);
+    while (!m_heap.empty()) {
+        std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        auto [depth, dist, line] = m_heap.back();
+        m_heap.pop_back();
+        if (m_settledIn[line] == m_run) {
+            continue;
+        }
+        m_settledIn[line] = m_run;
+        m_order.push_back(line);
+
+        const double halfLength = m_graph.getLength(line) * 0.5;
+        // the segment is connected at either end, whichever way the search came along it
+        for (bool forwards : {false, true}) {
+            uint32_t state = ShapeGraphCSR::getState(line, forwards);
+            for (uint32_t link = m_graph.getStateLinkOffset(state);
+                 link < m_graph.getStateLinkEnd(state); link++) {
+                uint32_t next = ShapeGraphCSR::getStateLine(m_graph.getStateLink(link));
+                if (m_settledIn[next] == m_run) {
+                    continue;
+                }
+                double nextDist = dist + halfLength + m_graph.getLength(next) * 0.5;
+                if (nextDist > limit) {
+                    continue;
+                }
+                double nextDepth = nextDist;
+                if constexpr (topological) {
+                    nextDepth = depth + (m_graph.getAxialRef(next) != m_graph.getAxialRef(line));
+                }
+                if (m_reachedIn[next] != m_run || nextDepth < m_depth[next] ||
+                    (nextDepth == m_depth[next] && nextDist < m_dist[next])) {
+                    m_reachedIn[next] = m_run;
+                    m_depth[next] = nextDepth;
+                    m_dist[next] = nextDist;
+                    m_parent[next] = line;
+                    m_heap.emplace_back(nextDepth, nextDist, next);
+                    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+                }
+            }
+        }
+    }
+}
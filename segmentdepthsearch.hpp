@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Least-depth search from one segment of a ShapeGraphCSR to the middle of
+// every other within a metric limit, either by distance or by the changes of
+// axial line on the way (and then by distance). The segments are kept in the
+// order they are settled, each with the one it was reached from, so that the
+// shortest path tree can be walked from the bottom up. The per-segment state
+// is stamped with the run it belongs to, so that one search can be reused for
+// every origin without clearing. Topological and metric searches are compiled
+// apart, so that the loop over the links does not check which one it is in
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+class SegmentDepthSearch {
+    // depth, distance, segment
+    using Entry = std::tuple<double, double, uint32_t>;
+
+    const ShapeGraphCSR &m_graph;
+    bool m_topological;
+    std::vector<uint32_t> m_reachedIn; // the run that last reached / settled every segment
+    std::vector<uint32_t> m_settledIn;
+    std::vector<double> m_depth;
+    std::vector<double> m_dist;
+    std::vector<uint32_t> m_parent;
+    std::vector<Entry> m_heap;
+    std::vector<uint32_t> m_order;
+    uint32_t m_run = 0;
+
+    void startRun();
+    template <bool topological>
+    void search(uint32_t origin, double limit);
+
+  public:
+    SegmentDepthSearch(const ShapeGraphCSR &graph, bool topological);
+
+    void run(uint32_t origin, double limit);
+
+    // valid for the segments of the last run
+    const std::vector<uint32_t> &getOrder() const { return m_order; }
+    double getDepth(uint32_t line) const { return m_depth[line]; }
+    double getDist(uint32_t line) const { return m_dist[line]; }
+    uint32_t getParent(uint32_t line) const { return m_parent[line]; }
+};
@@ -0,0 +1,466 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "segmentmetrichierarchy.hpp"
+
+#include "attributecolumntransaction.hpp"
+
+#include "salalib/segmmodules/segmmetricpd.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+
+    void combine(uint64_t &hash, uint64_t value) {
+        // as boost::hash_combine, widened to 64 bits
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 12) + (hash >> 4);
+    }
+
+    struct Link {
+        uint32_t line;
+        double weight;
+    };
+
+    // keeps the shorter of two links between the same lines
+    void addLink(std::vector<Link> &links, uint32_t line, double weight) {
+        for (auto &link : links) {
+            if (link.line == line) {
+                link.weight = std::min(link.weight, weight);
+                return;
+            }
+        }
+        links.push_back({line, weight});
+    }
+
+    // A search from one line for paths around another to some targets, through the lines that
+    // are still in the graph, that settles a limited number of lines. The state of every line is
+    // stamped with the search it belongs to, so that it is not cleared in between
+    class WitnessSearch {
+        using Entry = std::pair<double, uint32_t>;
+
+        const std::vector<std::vector<Link>> &m_links;
+        const std::vector<bool> &m_contracted;
+        std::vector<uint32_t> m_reachedIn;
+        std::vector<uint32_t> m_targetIn;
+        std::vector<double> m_dist;
+        std::vector<Entry> m_heap;
+        uint32_t m_run = 0;
+
+      public:
+        WitnessSearch(const std::vector<std::vector<Link>> &links,
+                      const std::vector<bool> &contracted)
+            : m_links(links), m_contracted(contracted), m_reachedIn(links.size(), 0),
+              m_targetIn(links.size(), 0), m_dist(links.size(), INF) {}
+
+        // stops once all the targets are settled or the rest are further than the limit
+        void run(uint32_t origin, uint32_t avoid, double limit,
+                 std::vector<Link>::const_iterator targetsBegin,
+                 std::vector<Link>::const_iterator targetsEnd) {
+            m_run++;
+            if (m_run == 0) {
+                std::fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+                std::fill(m_targetIn.begin(), m_targetIn.end(), 0);
+                m_run = 1;
+            }
+            size_t targetsLeft = 0;
+            for (auto it = targetsBegin; it != targetsEnd; ++it) {
+                m_targetIn[it->line] = m_run;
+                targetsLeft++;
+            }
+            m_heap.clear();
+            m_reachedIn[origin] = m_run;
+            m_dist[origin] = 0.0;
+            m_heap.emplace_back(0.0, origin);
+            size_t settled = 0;
+            while (!m_heap.empty() && targetsLeft > 0 &&
+                   settled < SegmentMetricHierarchy::WITNESS_SETTLE_LIMIT) {
+                std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+                auto [dist, line] = m_heap.back();
+                m_heap.pop_back();
+                if (dist > m_dist[line]) {
+                    continue;
+                }
+                settled++;
+                if (m_targetIn[line] == m_run) {
+                    targetsLeft--;
+                }
+                for (const auto &link : m_links[line]) {
+                    if (link.line == avoid || m_contracted[link.line]) {
+                        continue;
+                    }
+                    double nextDist = dist + link.weight;
+                    if (nextDist > limit) {
+                        continue;
+                    }
+                    if (m_reachedIn[link.line] != m_run || nextDist < m_dist[link.line]) {
+                        m_reachedIn[link.line] = m_run;
+                        m_dist[link.line] = nextDist;
+                        m_heap.emplace_back(nextDist, link.line);
+                        std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+                    }
+                }
+            }
+        }
+
+        // an upper bound on the distance, as the search may stop before it settles the line
+        double getDist(uint32_t line) const {
+            return m_reachedIn[line] == m_run ? m_dist[line] : INF;
+        }
+    };
+} // namespace
+
+// A search over the links up from some ranks, which keeps the ranks it settles in order along
+// with their distances, and is reused from one search to the next
+class SegmentMetricHierarchy::UpwardSearch {
+    using Entry = std::pair<double, uint32_t>;
+
+    const SegmentMetricHierarchy &m_hierarchy;
+    std::vector<uint32_t> m_reachedIn;
+    std::vector<double> m_dist;
+    std::vector<Entry> m_heap;
+    std::vector<std::pair<uint32_t, double>> m_settled;
+    uint32_t m_run = 0;
+
+  public:
+    UpwardSearch(const SegmentMetricHierarchy &hierarchy)
+        : m_hierarchy(hierarchy), m_reachedIn(hierarchy.getLineCount(), 0),
+          m_dist(hierarchy.getLineCount(), INF) {}
+
+    const std::vector<std::pair<uint32_t, double>> &run(const std::vector<uint32_t> &origins) {
+        m_run++;
+        if (m_run == 0) {
+            std::fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+            m_run = 1;
+        }
+        m_heap.clear();
+        m_settled.clear();
+        for (uint32_t origin : origins) {
+            m_reachedIn[origin] = m_run;
+            m_dist[origin] = 0.0;
+            m_heap.emplace_back(0.0, origin);
+        }
+        std::make_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+        while (!m_heap.empty()) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+            auto [dist, rank] = m_heap.back();
+            m_heap.pop_back();
+            if (dist > m_dist[rank]) {
+                continue;
+            }
+            m_settled.emplace_back(rank, dist);
+            for (uint32_t link = m_hierarchy.m_upOffsets[rank];
+                 link < m_hierarchy.m_upOffsets[rank + 1]; link++) {
+                uint32_t next = m_hierarchy.m_upLinks[link];
+                double nextDist = dist + m_hierarchy.m_upWeights[link];
+                if (m_reachedIn[next] != m_run || nextDist < m_dist[next]) {
+                    m_reachedIn[next] = m_run;
+                    m_dist[next] = nextDist;
+                    m_heap.emplace_back(nextDist, next);
+                    std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+                }
+            }
+        }
+        return m_settled;
+    }
+};
+
+uint64_t SegmentMetricHierarchy::getFingerprint(const ShapeGraph &map) {
+    const auto &shapes = map.getAllShapes();
+    const auto &connectors = map.getConnections();
+    const size_t lineCount = std::min(shapes.size(), connectors.size());
+    uint64_t hash = 0;
+    combine(hash, lineCount);
+    auto shapeIt = shapes.begin();
+    for (size_t line = 0; line < lineCount; line++, ++shapeIt) {
+        combine(hash, static_cast<uint64_t>(shapeIt->first));
+        // the lengths as they are kept in the graph
+        const auto length = static_cast<float>(shapeIt->second.getLength());
+        uint32_t lengthBits;
+        std::memcpy(&lengthBits, &length, sizeof(lengthBits));
+        combine(hash, lengthBits);
+        for (const auto *segconns :
+             {&connectors[line].backSegconns, &connectors[line].forwardSegconns}) {
+            combine(hash, segconns->size());
+            for (const auto &segconn : *segconns) {
+                combine(hash, static_cast<uint64_t>(segconn.first.ref));
+            }
+        }
+    }
+    return hash;
+}
+
+uint32_t SegmentMetricHierarchy::getLine(int ref) const {
+    auto it = std::lower_bound(m_refs.begin(), m_refs.end(), ref);
+    return it == m_refs.end() || *it != ref ? ShapeGraphCSR::NO_LINE
+                                            : static_cast<uint32_t>(it - m_refs.begin());
+}
+
+bool SegmentMetricHierarchy::build(const ShapeGraph &map, const ShapeGraphCSR &graph,
+                                   Communicator *comm) {
+    m_upOffsets.clear();
+    m_upLinks.clear();
+    m_upWeights.clear();
+    m_shortcutCount = 0;
+    if (!map.isSegmentMap() || !graph.hasStates() || graph.empty() || graph.isReordered()) {
+        return false;
+    }
+    const auto lineCount = static_cast<uint32_t>(graph.getLineCount());
+
+    // from middle to middle, whichever end the segments meet at
+    std::vector<std::vector<Link>> links(lineCount);
+    for (uint32_t line = 0; line < lineCount; line++) {
+        for (bool forwards : {false, true}) {
+            uint32_t state = ShapeGraphCSR::getState(line, forwards);
+            for (uint32_t link = graph.getStateLinkOffset(state);
+                 link < graph.getStateLinkEnd(state); link++) {
+                uint32_t next = ShapeGraphCSR::getStateLine(graph.getStateLink(link));
+                if (next == line) {
+                    continue;
+                }
+                double weight = (static_cast<double>(graph.getLength(line)) +
+                                 static_cast<double>(graph.getLength(next))) *
+                                0.5;
+                addLink(links[line], next, weight);
+                addLink(links[next], line, weight);
+            }
+        }
+    }
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, lineCount);
+    }
+
+    std::vector<bool> contracted(lineCount, false);
+    std::vector<uint32_t> contractedNeighbours(lineCount, 0);
+    WitnessSearch witnessSearch(links, contracted);
+
+    // the shortcuts that taking the line out would need, between its neighbours still in
+    struct Shortcut {
+        uint32_t from, to;
+        double weight;
+    };
+    std::vector<Link> neighbours;
+    std::vector<Shortcut> shortcuts;
+    auto findShortcuts = [&](uint32_t line) {
+        neighbours.clear();
+        shortcuts.clear();
+        for (const auto &link : links[line]) {
+            if (!contracted[link.line]) {
+                neighbours.push_back(link);
+            }
+        }
+        for (size_t i = 0; i + 1 < neighbours.size(); i++) {
+            double furthest = 0.0;
+            for (size_t j = i + 1; j < neighbours.size(); j++) {
+                furthest = std::max(furthest, neighbours[j].weight);
+            }
+            witnessSearch.run(neighbours[i].line, line, neighbours[i].weight + furthest,
+                              neighbours.cbegin() + static_cast<std::ptrdiff_t>(i + 1),
+                              neighbours.cend());
+            for (size_t j = i + 1; j < neighbours.size(); j++) {
+                double through = neighbours[i].weight + neighbours[j].weight;
+                if (witnessSearch.getDist(neighbours[j].line) > through) {
+                    shortcuts.push_back({neighbours[i].line, neighbours[j].line, through});
+                }
+            }
+        }
+    };
+    // lines that add fewer links than they take away go first, and the neighbours of those
+    // taken out are held back, so that the graph is taken apart evenly
+    auto getPriority = [&](uint32_t line) {
+        findShortcuts(line);
+        return static_cast<int64_t>(shortcuts.size()) - static_cast<int64_t>(neighbours.size()) +
+               contractedNeighbours[line];
+    };
+
+    using Entry = std::pair<int64_t, uint32_t>;
+    std::vector<Entry> queue;
+    queue.reserve(lineCount);
+    for (uint32_t line = 0; line < lineCount; line++) {
+        queue.emplace_back(getPriority(line), line);
+    }
+    std::make_heap(queue.begin(), queue.end(), std::greater<Entry>());
+
+    m_ranks.assign(lineCount, 0);
+    m_rankLines.assign(lineCount, 0);
+    uint32_t rank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<Entry>());
+        uint32_t line = queue.back().second;
+        queue.pop_back();
+        // the priority may have gone up since it was queued
+        int64_t priority = getPriority(line);
+        if (!queue.empty() && priority > queue.front().first) {
+            queue.emplace_back(priority, line);
+            std::push_heap(queue.begin(), queue.end(), std::greater<Entry>());
+            continue;
+        }
+        for (const auto &shortcut : shortcuts) {
+            addLink(links[shortcut.from], shortcut.to, shortcut.weight);
+            addLink(links[shortcut.to], shortcut.from, shortcut.weight);
+        }
+        m_shortcutCount += shortcuts.size();
+        for (const auto &neighbour : neighbours) {
+            contractedNeighbours[neighbour.line]++;
+        }
+        contracted[line] = true;
+        m_ranks[line] = rank;
+        m_rankLines[rank] = line;
+        rank++;
+
+        if (comm) {
+            if (qtimer(atime, 500)) {
+                if (comm->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                comm->CommPostMessage(Communicator::CURRENT_RECORD, rank);
+            }
+        }
+    }
+
+    // every line keeps the links to the lines taken out after it, which are all the links it
+    // had to lines still in when it was taken out
+    m_upOffsets.reserve(lineCount + 1);
+    m_upOffsets.push_back(0);
+    for (uint32_t r = 0; r < lineCount; r++) {
+        for (const auto &link : links[m_rankLines[r]]) {
+            if (m_ranks[link.line] > r) {
+                m_upLinks.push_back(m_ranks[link.line]);
+                m_upWeights.push_back(link.weight);
+            }
+        }
+        m_upOffsets.push_back(static_cast<uint32_t>(m_upLinks.size()));
+    }
+
+    m_refs.resize(lineCount);
+    m_lengths.resize(lineCount);
+    for (uint32_t line = 0; line < lineCount; line++) {
+        m_refs[line] = graph.getRef(line);
+        m_lengths[line] = graph.getLength(line);
+    }
+    m_fingerprint = getFingerprint(map);
+    return true;
+}
+
+std::vector<double>
+SegmentMetricHierarchy::getRankDistances(const std::vector<uint32_t> &originLines) const {
+    const size_t lineCount = m_refs.size();
+    std::vector<double> dist(lineCount, INF);
+    if (originLines.empty()) {
+        return dist;
+    }
+    std::vector<uint32_t> originRanks;
+    for (uint32_t line : originLines) {
+        originRanks.push_back(m_ranks[line]);
+    }
+    UpwardSearch search(*this);
+    for (const auto &[rank, rankDist] : search.run(originRanks)) {
+        dist[rank] = rankDist;
+    }
+    // every shortest path goes up and then down the ranks, so going down them all in order
+    // settles every line from the ones above it
+    for (size_t r = lineCount; r-- > 0;) {
+        double best = dist[r];
+        for (uint32_t link = m_upOffsets[r]; link < m_upOffsets[r + 1]; link++) {
+            best = std::min(best, dist[m_upLinks[link]] + m_upWeights[link]);
+        }
+        dist[r] = best;
+    }
+    return dist;
+}
+
+std::vector<double> SegmentMetricHierarchy::getDistances(const std::set<int> &originRefs) const {
+    std::vector<uint32_t> originLines;
+    for (int ref : originRefs) {
+        uint32_t line = getLine(ref);
+        if (line != ShapeGraphCSR::NO_LINE) {
+            originLines.push_back(line);
+        }
+    }
+    const auto rankDist = getRankDistances(originLines);
+    std::vector<double> distances(m_refs.size());
+    for (size_t line = 0; line < m_refs.size(); line++) {
+        double dist = rankDist[m_ranks[line]];
+        distances[line] = dist == INF ? UNREACHABLE : dist;
+    }
+    return distances;
+}
+
+std::vector<double>
+SegmentMetricHierarchy::getDistanceTable(const std::vector<int> &originRefs,
+                                         const std::vector<int> &destinationRefs) const {
+    const size_t destinationCount = destinationRefs.size();
+    std::vector<double> table(originRefs.size() * destinationCount, INF);
+    if (empty()) {
+        std::fill(table.begin(), table.end(), UNREACHABLE);
+        return table;
+    }
+    UpwardSearch search(*this);
+
+    // every rank the search up from a destination gets to keeps its distance from there
+    std::vector<std::vector<std::pair<uint32_t, double>>> buckets(m_refs.size());
+    for (size_t d = 0; d < destinationCount; d++) {
+        uint32_t line = getLine(destinationRefs[d]);
+        if (line == ShapeGraphCSR::NO_LINE) {
+            continue;
+        }
+        for (const auto &[rank, dist] : search.run({m_ranks[line]})) {
+            buckets[rank].emplace_back(static_cast<uint32_t>(d), dist);
+        }
+    }
+    // and the searches up from the origins meet them there
+    for (size_t o = 0; o < originRefs.size(); o++) {
+        uint32_t line = getLine(originRefs[o]);
+        if (line == ShapeGraphCSR::NO_LINE) {
+            continue;
+        }
+        double *row = &table[o * destinationCount];
+        for (const auto &[rank, dist] : search.run({m_ranks[line]})) {
+            for (const auto &[d, bucketDist] : buckets[rank]) {
+                row[d] = std::min(row[d], dist + bucketDist);
+            }
+        }
+    }
+
+    for (auto &dist : table) {
+        if (dist == INF) {
+            dist = UNREACHABLE;
+        }
+    }
+    return table;
+}
+
+bool SegmentMetricHierarchy::writeMetricStepDepth(ShapeGraph &map,
+                                                  const std::set<int> &originRefs) const {
+    if (!matches(map)) {
+        return false;
+    }
+    const auto distances = getDistances(originRefs);
+
+    auto &attributes = map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(SegmentMetricPD::Column::METRIC_STEP_DEPTH);
+    // the column order might have changed while inserting, retrieve them all again:
+    auto depthCol = transaction.getColumnIndex(SegmentMetricPD::Column::METRIC_STEP_DEPTH);
+
+    for (size_t line = 0; line < m_refs.size(); line++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_refs[line]));
+        if (row == nullptr) {
+            continue;
+        }
+        row->setValue(depthCol, distances[line] == UNREACHABLE
+                                    ? -1.0f
+                                    : static_cast<float>(distances[line] + m_lengths[line] * 0.5));
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// A contraction hierarchy over the metric distances between the middles of
+// the segments of a segment map (as in SegmentDepthSearch), made once so that
+// many distance queries on the same map do not each search the whole graph.
+// The segments are taken out of the graph one at a time, least important
+// first, leaving a shortcut between every two of their neighbours that have
+// no other path as short between them. The segments are then numbered in the
+// order they were taken out, and only the links up to later segments are
+// kept. The distances from a set of origins to all the segments come from a
+// search upwards from the origins followed by a single sweep down over all
+// the segments, and the distances between two sets from where the searches
+// upwards from either side meet. The hierarchy is only good for the map it
+// was made from, which is checked through a fingerprint before every use
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include "salalib/genlib/comm.hpp"
+#include "salalib/shapegraph.hpp"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+class SegmentMetricHierarchy {
+  public:
+    static constexpr double UNREACHABLE = -1.0;
+    // segments settled by the search for a path around a segment before giving up on it (and
+    // keeping the shortcut, which is never wrong, only not needed)
+    static constexpr size_t WITNESS_SETTLE_LIMIT = 256;
+
+  private:
+    std::vector<int> m_refs;           // line -> shape key, sorted as in ShapeGraphCSR
+    std::vector<float> m_lengths;      // line -> length
+    std::vector<uint32_t> m_ranks;     // line -> the order it was taken out in
+    std::vector<uint32_t> m_rankLines; // rank -> line
+    // the links up from every rank, to the ranks above it
+    std::vector<uint32_t> m_upOffsets;
+    std::vector<uint32_t> m_upLinks;
+    std::vector<double> m_upWeights;
+    size_t m_shortcutCount = 0;
+    uint64_t m_fingerprint = 0;
+
+    class UpwardSearch;
+
+    uint32_t getLine(int ref) const;
+    std::vector<double> getRankDistances(const std::vector<uint32_t> &originLines) const;
+
+  public:
+    // of the segments, their lengths and their connections, as the graph is made from them
+    static uint64_t getFingerprint(const ShapeGraph &map);
+
+    // Contracts the graph of a segment map. The graph has to be in the order of the shape keys.
+    // False for axial maps
+    bool build(const ShapeGraph &map, const ShapeGraphCSR &graph, Communicator *comm);
+
+    bool empty() const { return m_upOffsets.empty(); }
+    bool matches(const ShapeGraph &map) const {
+        return !empty() && getFingerprint(map) == m_fingerprint;
+    }
+    size_t getLineCount() const { return m_refs.size(); }
+    size_t getShortcutCount() const { return m_shortcutCount; }
+    const std::vector<int> &getRefs() const { return m_refs; }
+
+    // the least distance from any of the origins to the middle of every segment, in the order of
+    // getRefs (UNREACHABLE for those out of reach)
+    std::vector<double> getDistances(const std::set<int> &originRefs) const;
+    // the distance from every origin to every destination, a row per origin
+    std::vector<double> getDistanceTable(const std::vector<int> &originRefs,
+                                         const std::vector<int> &destinationRefs) const;
+    // as SegmentMetricPD, into its step depth column, i.e. up to the far end of every segment
+    bool writeMetricStepDepth(ShapeGraph &map, const std::set<int> &originRefs) const;
+};
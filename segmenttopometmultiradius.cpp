@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "segmenttopometmultiradius.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "segmentdepthsearch.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/segmmodules/segmmetric.hpp"
+#include "salalib/segmmodules/segmtopological.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace {
+    // the scratch space of a worker, kept from one origin to the next
+    struct Arena {
+        std::unique_ptr<SegmentDepthSearch> search;
+        std::vector<uint32_t> below; // segments under every segment of the tree of the origin
+    };
+
+    struct Sums {
+        size_t count = 0;
+        double depth = 0.0;
+    };
+} // namespace
+
+bool SegmentTopoMetMultiRadius::run(Communicator *comm) {
+    if (m_radiusSet.empty() || !m_graph.hasStates()) {
+        return false;
+    }
+    const auto lineCount = static_cast<uint32_t>(m_graph.getLineCount());
+    // choice needs the paths from every segment, so it is left out when analysing a selection
+    const bool choice = m_originMask == nullptr;
+
+    std::vector<uint32_t> origins;
+    if (m_originMask != nullptr) {
+        origins = m_originMask->getLines();
+    } else {
+        for (uint32_t line = 0; line < lineCount; line++) {
+            origins.push_back(line);
+        }
+    }
+    if (origins.empty()) {
+        return false;
+    }
+
+    // radius n (-1) goes last, as it includes everything
+    std::vector<double> radii(m_radiusSet.begin(), m_radiusSet.end());
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+    }
+    std::vector<double> limits;
+    for (double radius : radii) {
+        limits.push_back(radius < 0 ? std::numeric_limits<double>::infinity() : radius);
+    }
+    const size_t radiusCount = radii.size();
+
+    WorkStealingPool pool(m_threadCount);
+    std::vector<Arena> arenas(pool.getThreadCount());
+    // values per radius: mean depth
+    std::vector<float> meanDepths(origins.size() * radiusCount, -1.0f);
+    // radius * segments + segment, added to by every worker. Whole counts, so the sums come out
+    // the same in whatever order the workers add to them
+    std::vector<std::atomic<uint64_t>> choiceCounts(choice ? radiusCount * lineCount : 0);
+
+    // the depths and choice counts of the first reachedCount segments settled
+    auto accumulate = [&](Arena &arena, size_t index, size_t r, size_t reachedCount) {
+        const auto &search = *arena.search;
+        const auto &order = search.getOrder();
+        Sums sums;
+        for (size_t q = 1; q < reachedCount; q++) {
+            sums.count++;
+            sums.depth += search.getDepth(order[q]);
+        }
+        if (sums.count > 0) {
+            meanDepths[index * radiusCount + r] =
+                static_cast<float>(sums.depth / static_cast<double>(sums.count));
+        }
+        if (!choice) {
+            return;
+        }
+        // every segment deeper in the tree is a path through this one from the origin, so the
+        // choice of a segment goes up by the segments under it, from the bottom of the tree up
+        std::atomic<uint64_t> *radiusChoice = &choiceCounts[r * lineCount];
+        for (size_t q = 0; q < reachedCount; q++) {
+            arena.below[order[q]] = 0;
+        }
+        for (size_t q = reachedCount; q-- > 1;) {
+            uint32_t line = order[q];
+            if (arena.below[line] != 0) {
+                radiusChoice[line].fetch_add(arena.below[line], std::memory_order_relaxed);
+            }
+            arena.below[search.getParent(line)] += arena.below[line] + 1;
+        }
+    };
+
+    pool.parallelFor(
+        origins.size(),
+        [&](size_t index, size_t worker) {
+            const uint32_t origin = origins[index];
+            auto &arena = arenas[worker];
+            if (!arena.search) {
+                arena.search = std::make_unique<SegmentDepthSearch>(m_graph, m_topological);
+                if (choice) {
+                    arena.below.resize(lineCount);
+                }
+            }
+            auto &search = *arena.search;
+
+            if (m_topological) {
+                for (size_t r = 0; r < radiusCount; r++) {
+                    search.run(origin, limits[r]);
+                    accumulate(arena, index, r, search.getOrder().size());
+                }
+                return;
+            }
+            search.run(origin, limits.back());
+            // the segments within every radius are the start of the order, up to the first one
+            // further away
+            const auto &order = search.getOrder();
+            size_t q = 0;
+            for (size_t r = 0; r < radiusCount; r++) {
+                while (q < order.size() && search.getDist(order[q]) <= limits[r]) {
+                    q++;
+                }
+                accumulate(arena, index, r, q);
+            }
+        },
+        comm);
+
+    auto getColumnName = [&](bool choiceColumn, double radius) {
+        if (m_topological) {
+            return SegmentTopological::getFormattedColumn(
+                choiceColumn ? SegmentTopological::Column::TOPOLOGICAL_CHOICE
+                             : SegmentTopological::Column::TOPOLOGICAL_MEAN_DEPTH,
+                radius);
+        }
+        return SegmentMetric::getFormattedColumn(choiceColumn
+                                                     ? SegmentMetric::Column::METRIC_CHOICE
+                                                     : SegmentMetric::Column::METRIC_MEAN_DEPTH,
+                                                 radius);
+    };
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    for (double radius : radii) {
+        if (choice) {
+            transaction.insertOrResetColumn(getColumnName(true, radius));
+        }
+        transaction.insertOrResetColumn(getColumnName(false, radius));
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> choiceCols, meanDepthCols;
+    for (double radius : radii) {
+        if (choice) {
+            choiceCols.push_back(transaction.getColumnIndex(getColumnName(true, radius)));
+        }
+        meanDepthCols.push_back(transaction.getColumnIndex(getColumnName(false, radius)));
+    }
+
+    for (size_t index = 0; index < origins.size(); index++) {
+        const uint32_t line = origins[index];
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(line)));
+        if (row == nullptr) {
+            continue;
+        }
+        for (size_t r = 0; r < radiusCount; r++) {
+            row->setValue(meanDepthCols[r], meanDepths[index * radiusCount + r]);
+            if (!choice) {
+                continue;
+            }
+            row->setValue(choiceCols[r], static_cast<float>(choiceCounts[r * lineCount + line].load(
+                                             std::memory_order_relaxed)));
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Segment topological or metric analysis for a whole set of metric radii
+// in one go. Metric analysis runs a single search from every origin out to
+// the largest radius, as the segments within a smaller radius are the ones
+// settled first and their paths stay within it. Topological analysis goes by
+// the fewest changes of axial line, and the path with the fewest changes may
+// be too long for a smaller radius when another is not, so there every radius
+// is searched on its own, with the same scratch space. The origins are shared
+// out among threads, which all add to the one set of choice counts. Gives the
+// choice and mean depth columns of SegmentTopological and SegmentMetric
+
+#pragma once
+
+#include "originmask.hpp"
+#include "shapegraphcsr.hpp"
+
+#include "salalib/shapegraph.hpp"
+
+#include <set>
+
+class SegmentTopoMetMultiRadius {
+    ShapeGraph &m_map;
+    const ShapeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // metric, -1 for radius n
+    bool m_topological;
+    // when set, only the origins marked here are analysed, and without choice
+    const OriginMask *m_originMask;
+    size_t m_threadCount;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    SegmentTopoMetMultiRadius(ShapeGraph &map, const ShapeGraphCSR &graph,
+                              std::set<double> radiusSet, bool topological,
+                              const OriginMask *originMask, size_t threadCount = 1)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)),
+          m_topological(topological), m_originMask(originMask), m_threadCount(threadCount) {}
+    std::string getAnalysisName() const {
+        return m_topological ? "Topological Analysis (Multiple Radii)"
+                             : "Metric Analysis (Multiple Radii)";
+    }
+    bool run(Communicator *comm);
+};
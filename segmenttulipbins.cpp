@@ -0,0 +1,320 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "segmenttulipbins.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "tulipbinsearch.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/segmmodules/segmtulip.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+
+namespace {
+    struct RadiusSums {
+        size_t count = 0;
+        double depth = 0.0; // in bins
+        double length = 0.0;
+    };
+
+    // values per radius: integration, mean depth, node count, total depth and total length
+    constexpr size_t VALUES_PER_RADIUS = 5;
+
+    // The points in rounds, every round taking the next point of every cell of a grid over them
+    // (the cells in a shuffled order), so that any run of the order is spread over the map. The
+    // cell of every point goes to cells
+    std::vector<size_t> getStratifiedOrder(const std::vector<Point2f> &points, size_t cellsPerSide,
+                                           uint32_t seed, std::vector<size_t> &cells) {
+        double minX = std::numeric_limits<double>::infinity(), minY = minX;
+        double maxX = -minX, maxY = -minX;
+        for (const auto &point : points) {
+            minX = std::min(minX, point.x);
+            minY = std::min(minY, point.y);
+            maxX = std::max(maxX, point.x);
+            maxY = std::max(maxY, point.y);
+        }
+        auto getCell = [cellsPerSide](double value, double min, double max) {
+            if (!(max > min)) {
+                return size_t(0);
+            }
+            auto cell = static_cast<size_t>((value - min) / (max - min) *
+                                            static_cast<double>(cellsPerSide));
+            return std::min(cell, cellsPerSide - 1);
+        };
+        std::vector<std::vector<size_t>> members(cellsPerSide * cellsPerSide);
+        cells.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            cells[i] = getCell(points[i].y, minY, maxY) * cellsPerSide +
+                       getCell(points[i].x, minX, maxX);
+            members[cells[i]].push_back(i);
+        }
+
+        std::mt19937 generator(seed);
+        std::vector<size_t> cellOrder;
+        for (size_t cell = 0; cell < members.size(); cell++) {
+            if (!members[cell].empty()) {
+                std::shuffle(members[cell].begin(), members[cell].end(), generator);
+                cellOrder.push_back(cell);
+            }
+        }
+        std::shuffle(cellOrder.begin(), cellOrder.end(), generator);
+
+        std::vector<size_t> order;
+        order.reserve(points.size());
+        for (size_t round = 0; !cellOrder.empty(); round++) {
+            for (size_t cell : cellOrder) {
+                order.push_back(members[cell][round]);
+            }
+            // the cells run out of points one by one, and are then left out of the rounds
+            cellOrder.erase(std::remove_if(cellOrder.begin(), cellOrder.end(),
+                                           [&](size_t cell) {
+                                               return members[cell].size() == round + 1;
+                                           }),
+                            cellOrder.end());
+        }
+        return order;
+    }
+} // namespace
+
+std::vector<uint32_t> SegmentTulipBins::getOrigins() const {
+    if (m_originMask != nullptr) {
+        return m_originMask->getLines();
+    }
+    std::vector<uint32_t> origins;
+    for (uint32_t line = 0; line < m_graph.getLineCount(); line++) {
+        origins.push_back(line);
+    }
+    return origins;
+}
+
+std::shared_ptr<ProgressiveColumn> SegmentTulipBins::makeProgressive(const std::string &column,
+                                                                     double radius,
+                                                                     size_t publishInterval,
+                                                                     uint32_t seed) {
+    m_progressiveValue = column;
+    m_progressiveRadius = radius;
+    m_publishInterval = std::max(publishInterval, size_t(1));
+
+    // a batch has about one origin in every cell
+    const auto cellsPerSide = std::max(
+        size_t(1),
+        static_cast<size_t>(std::round(std::sqrt(static_cast<double>(m_publishInterval)))));
+    const auto origins = getOrigins();
+    std::vector<Point2f> centroids;
+    centroids.reserve(origins.size());
+    const auto &shapes = m_map.getAllShapes();
+    for (uint32_t origin : origins) {
+        centroids.push_back(shapes.at(m_graph.getRef(origin)).getCentroid());
+    }
+    m_progressiveOrder = getStratifiedOrder(centroids, cellsPerSide, seed, m_progressiveCells);
+
+    // the rows of the column are the lines, the origins not done yet show the mean of those
+    // done in their cell, or of all of them
+    std::vector<int> refs;
+    for (uint32_t line = 0; line < m_graph.getLineCount(); line++) {
+        refs.push_back(m_graph.getRef(line));
+    }
+    std::vector<uint32_t> rowCells(refs.size(), ProgressiveColumn::NO_CELL);
+    for (size_t index = 0; index < origins.size(); index++) {
+        rowCells[origins[index]] = static_cast<uint32_t>(m_progressiveCells[index]);
+    }
+    m_progressiveColumn = std::make_shared<ProgressiveColumn>(
+        SegmentTulip::getFormattedColumn(column, m_tulipBins, m_radiusType, radius),
+        std::move(refs), std::move(rowCells), cellsPerSide * cellsPerSide);
+    return m_progressiveColumn;
+}
+
+bool SegmentTulipBins::run(Communicator *comm) {
+    if (m_radiusSet.empty() || !m_graph.hasStates() || m_tulipBins < 4) {
+        return false;
+    }
+
+    const std::vector<uint32_t> origins = getOrigins();
+    if (origins.empty()) {
+        return false;
+    }
+
+    // radius n (-1) goes last, as it includes everything. Angular limits are in bins
+    const double binsPerRightAngle = TulipBinSearch::getBinsPerRightAngle(m_tulipBins);
+    std::vector<double> radii(m_radiusSet.begin(), m_radiusSet.end());
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+    }
+    std::vector<double> limits;
+    for (double radius : radii) {
+        limits.push_back(radius < 0 ? std::numeric_limits<double>::infinity()
+                         : m_radiusType == RadiusType::ANGULAR ? radius * binsPerRightAngle
+                                                               : radius);
+    }
+    // the lines within a smaller angular radius are the ones settled first on the way to the
+    // largest, which is not so for the other radius types, as the least angle path to a line
+    // might be longer than another that would still be in the smaller radius
+    const bool singleSearch =
+        m_radiusType == RadiusType::ANGULAR || m_radiusType == RadiusType::NONE || radii[0] < 0;
+    const size_t radiusCount = radii.size();
+
+    const auto costs = TulipBinSearch::getLinkCosts(m_graph, m_tulipBins);
+    WorkStealingPool pool(m_threadCount);
+    std::vector<std::unique_ptr<TulipBinSearch>> searches(pool.getThreadCount());
+    std::vector<std::vector<RadiusSums>> workerSums(pool.getThreadCount());
+    const size_t valuesPerLine = radiusCount * VALUES_PER_RADIUS;
+    std::vector<float> values(origins.size() * valuesPerLine, -1.0f);
+
+    using Column = SegmentTulip::Column;
+    const std::vector<std::string> columns = {Column::INTEGRATION, Column::MEAN_DEPTH,
+                                              Column::NODE_COUNT, Column::TOTAL_DEPTH,
+                                              Column::TOTAL_SEGMENT_LENGTH};
+    // the value that goes to the progressive column, out of the values of a line
+    size_t progressiveIdx = 0;
+    if (m_progressiveColumn) {
+        auto columnIt = std::find(columns.begin(), columns.end(), m_progressiveValue);
+        auto radiusIt = std::find(radii.begin(), radii.end(), m_progressiveRadius);
+        if (columnIt == columns.end() || radiusIt == radii.end() ||
+            m_progressiveOrder.size() != origins.size()) {
+            return false;
+        }
+        progressiveIdx =
+            static_cast<size_t>(radiusIt - radii.begin()) * VALUES_PER_RADIUS +
+            static_cast<size_t>(columnIt - columns.begin());
+    }
+
+    auto analyseOrigin = [&](size_t index, size_t worker) {
+        const uint32_t origin = origins[index];
+        if (!searches[worker]) {
+            searches[worker] = std::make_unique<TulipBinSearch>(m_graph, costs);
+        }
+        auto &sums = workerSums[worker];
+        sums.assign(radiusCount, RadiusSums());
+
+        if (singleSearch) {
+            // radius n of the other types has no limit to keep to
+            searches[worker]->run(
+                origin,
+                m_radiusType == RadiusType::ANGULAR ? RadiusType::ANGULAR : RadiusType::NONE,
+                limits.back(), [&](uint32_t line, uint32_t depth) {
+                    // counted in the smallest radius it fits in, the larger ones are summed
+                    // up below
+                    auto radiusIdx = static_cast<size_t>(
+                        std::lower_bound(limits.begin(), limits.end(),
+                                         static_cast<double>(depth)) -
+                        limits.begin());
+                    sums[radiusIdx].count++;
+                    sums[radiusIdx].depth += depth;
+                    sums[radiusIdx].length += m_graph.getLength(line);
+                });
+            for (size_t r = 1; r < radiusCount; r++) {
+                sums[r].count += sums[r - 1].count;
+                sums[r].depth += sums[r - 1].depth;
+                sums[r].length += sums[r - 1].length;
+            }
+        } else {
+            for (size_t r = 0; r < radiusCount; r++) {
+                searches[worker]->run(origin, m_radiusType, limits[r],
+                                      [&](uint32_t line, uint32_t depth) {
+                                          sums[r].count++;
+                                          sums[r].depth += depth;
+                                          sums[r].length += m_graph.getLength(line);
+                                      });
+            }
+        }
+
+        float *lineValues = &values[index * valuesPerLine];
+        for (size_t r = 0; r < radiusCount; r++) {
+            // the origin is one of the nodes, at depth 0
+            const double count = static_cast<double>(sums[r].count);
+            const double totalDepth = sums[r].depth / binsPerRightAngle;
+            float *radiusValues = &lineValues[r * VALUES_PER_RADIUS];
+            if (totalDepth > 0.0) {
+                radiusValues[0] = static_cast<float>(count * count / totalDepth);
+            }
+            radiusValues[1] = static_cast<float>(totalDepth / count);
+            radiusValues[2] = static_cast<float>(count);
+            radiusValues[3] = static_cast<float>(totalDepth);
+            radiusValues[4] = static_cast<float>(sums[r].length);
+        }
+    };
+
+    if (!m_progressiveColumn) {
+        pool.parallelFor(origins.size(), analyseOrigin, comm);
+    } else {
+        const auto &order = m_progressiveOrder;
+        const auto &cells = m_progressiveCells;
+        const size_t cellCount = m_progressiveColumn->getCellCount();
+        std::vector<double> cellSums(cellCount, 0.0);
+        std::vector<size_t> cellCounts(cellCount, 0);
+        double totalSum = 0.0;
+        size_t totalCount = 0;
+        for (size_t batchStart = 0; batchStart < order.size(); batchStart += m_publishInterval) {
+            const size_t batchEnd = std::min(batchStart + m_publishInterval, order.size());
+            pool.parallelFor(
+                batchEnd - batchStart,
+                [&](size_t i, size_t worker) { analyseOrigin(order[batchStart + i], worker); },
+                comm);
+            // only the origins of the batch and their cells change
+            for (size_t i = batchStart; i < batchEnd; i++) {
+                const size_t index = order[i];
+                const float value = values[index * valuesPerLine + progressiveIdx];
+                m_progressiveColumn->setValue(origins[index], value);
+                // values that could not be worked out say nothing about the others
+                if (value >= 0.0f) {
+                    cellSums[cells[index]] += value;
+                    cellCounts[cells[index]]++;
+                    totalSum += value;
+                    totalCount++;
+                }
+            }
+            for (size_t i = batchStart; i < batchEnd; i++) {
+                const size_t cell = cells[order[i]];
+                if (cellCounts[cell] > 0) {
+                    m_progressiveColumn->setCellMean(
+                        static_cast<uint32_t>(cell),
+                        static_cast<float>(cellSums[cell] / static_cast<double>(cellCounts[cell])));
+                }
+            }
+            if (totalCount > 0) {
+                m_progressiveColumn->setMean(
+                    static_cast<float>(totalSum / static_cast<double>(totalCount)));
+            }
+            m_progressiveColumn->publish(static_cast<double>(batchEnd) /
+                                         static_cast<double>(order.size()));
+        }
+    }
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    for (double radius : radii) {
+        for (const auto &column : columns) {
+            transaction.insertOrResetColumn(
+                SegmentTulip::getFormattedColumn(column, m_tulipBins, m_radiusType, radius));
+        }
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> cols;
+    for (double radius : radii) {
+        for (const auto &column : columns) {
+            cols.push_back(transaction.getColumnIndex(
+                SegmentTulip::getFormattedColumn(column, m_tulipBins, m_radiusType, radius)));
+        }
+    }
+
+    for (size_t index = 0; index < origins.size(); index++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(origins[index])));
+        if (row == nullptr) {
+            continue;
+        }
+        for (size_t v = 0; v < valuesPerLine; v++) {
+            row->setValue(cols[v], values[index * valuesPerLine + v]);
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
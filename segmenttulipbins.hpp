@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Angular segment analysis with the tulip bins of SegmentTulip, through a
+// TulipBinSearch from every origin. The link costs are worked out once for the
+// map, the origins are shared out among threads, each with a search of its
+// own that is reused from one origin to the next, and the values are written
+// to the table once all of them are done. Angular radii come out of a single
+// search to the largest one, metric and topological radii out of one search
+// each. Gives the integration, mean depth, node count, total depth and total
+// segment length columns of SegmentTulip, without weights or choice. In the
+// progressive mode the origins go in batches, in an order spread evenly over
+// the map, and after every batch one of the columns is published with the
+// values of the origins so far and estimates for the rest
+
+#pragma once
+
+#include "originmask.hpp"
+#include "progressivecolumn.hpp"
+#include "shapegraphcsr.hpp"
+
+#include "salalib/radiustype.hpp"
+#include "salalib/shapegraph.hpp"
+
+#include <memory>
+#include <set>
+#include <string>
+
+class SegmentTulipBins {
+  public:
+    // origins analysed between two publishes of the progressive column
+    static constexpr size_t DEFAULT_PUBLISH_INTERVAL = 256;
+
+  private:
+    ShapeGraph &m_map;
+    const ShapeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // -1 for radius n
+    // when set, only the origins marked here are analysed
+    const OriginMask *m_originMask;
+    int m_tulipBins;
+    RadiusType m_radiusType;
+    size_t m_threadCount;
+    // the progressive mode, when there is a column to publish to
+    std::shared_ptr<ProgressiveColumn> m_progressiveColumn;
+    std::string m_progressiveValue; // a column of SegmentTulip
+    double m_progressiveRadius = -1;
+    size_t m_publishInterval = DEFAULT_PUBLISH_INTERVAL;
+    // the origins in the order they are analysed in, by index, and the cell of every origin
+    std::vector<size_t> m_progressiveOrder;
+    std::vector<size_t> m_progressiveCells;
+
+    std::vector<uint32_t> getOrigins() const;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    SegmentTulipBins(ShapeGraph &map, const ShapeGraphCSR &graph, std::set<double> radiusSet,
+                     const OriginMask *originMask, int tulipBins, RadiusType radiusType,
+                     size_t threadCount = 1)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)),
+          m_originMask(originMask), m_tulipBins(tulipBins), m_radiusType(radiusType),
+          m_threadCount(threadCount) {}
+    std::string getAnalysisName() const { return "Tulip Analysis (Bin Queue)"; }
+    // Makes the column the values of column (one of the columns of SegmentTulip given here) at
+    // radius are published to every publishInterval origins, complete before it is shown. The
+    // origins that are not done yet get the mean of those done in the same cell of a grid over
+    // the map, which is as fine as the number of origins in a batch, so that every batch has
+    // about one origin per cell. The order within the cells is shuffled with the seed
+    std::shared_ptr<ProgressiveColumn>
+    makeProgressive(const std::string &column, double radius,
+                    size_t publishInterval = DEFAULT_PUBLISH_INTERVAL, uint32_t seed = 0);
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,235 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "shapegraphcsr.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // the distance along a Hilbert curve through a grid of 2^16 by 2^16 cells
+    uint64_t getHilbertIndex(uint32_t x, uint32_t y) {
+        constexpr uint32_t side = 1u << 16;
+        uint64_t index = 0;
+        for (uint32_t half = side / 2; half > 0; half /= 2) {
+            const uint32_t rx = (x & half) > 0 ? 1 : 0;
+            const uint32_t ry = (y & half) > 0 ? 1 : 0;
+            index += static_cast<uint64_t>(half) * half * ((3 * rx) ^ ry);
+            // turn the quadrant so that the curve goes on from where it left it
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = side - 1 - x;
+                    y = side - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return index;
+    }
+
+    std::vector<uint32_t> getHilbertOrder(const std::vector<Point2f> &centroids) {
+        if (centroids.empty()) {
+            return {};
+        }
+        double minX = centroids[0].x, maxX = minX, minY = centroids[0].y, maxY = minY;
+        for (const auto &centroid : centroids) {
+            minX = std::min(minX, centroid.x);
+            maxX = std::max(maxX, centroid.x);
+            minY = std::min(minY, centroid.y);
+            maxY = std::max(maxY, centroid.y);
+        }
+        // the same scale both ways, so that the cells are square
+        const double extent = std::max({maxX - minX, maxY - minY, 1e-9});
+        const double scale = static_cast<double>((1u << 16) - 1) / extent;
+        std::vector<uint64_t> indices(centroids.size());
+        for (size_t line = 0; line < centroids.size(); line++) {
+            indices[line] =
+                getHilbertIndex(static_cast<uint32_t>((centroids[line].x - minX) * scale),
+                                static_cast<uint32_t>((centroids[line].y - minY) * scale));
+        }
+        std::vector<uint32_t> order(centroids.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) { return indices[a] < indices[b]; });
+        return order;
+    }
+} // namespace
+
+ShapeGraphCSR::ShapeGraphCSR(ShapeGraph &map, Ordering ordering) {
+    const auto &shapes = map.getAllShapes();
+    const auto &connectors = map.getConnections();
+    const size_t lineCount = std::min(shapes.size(), connectors.size());
+
+    m_refs.reserve(lineCount);
+    m_lengths.reserve(lineCount);
+    std::vector<Point2f> centroids;
+    for (const auto &shape : shapes) {
+        if (m_refs.size() == lineCount) {
+            break;
+        }
+        m_refs.push_back(shape.first);
+        m_lengths.push_back(static_cast<float>(shape.second.getLength()));
+        if (ordering == Ordering::HILBERT) {
+            centroids.push_back(shape.second.getCentroid());
+        }
+    }
+
+    m_offsets.resize(lineCount + 1);
+    m_offsets[0] = 0;
+    for (size_t line = 0; line < lineCount; line++) {
+        for (size_t other : connectors[line].connections) {
+            // connections to a line past the end would only come from a stale connector
+            if (other < lineCount && other != line) {
+                m_connections.push_back(static_cast<uint32_t>(other));
+            }
+        }
+        m_offsets[line + 1] = static_cast<uint32_t>(m_connections.size());
+    }
+
+    if (map.isSegmentMap()) {
+        makeStates(connectors);
+    }
+
+    switch (ordering) {
+    case Ordering::HILBERT:
+        reorder(getHilbertOrder(centroids));
+        break;
+    case Ordering::REVERSE_CUTHILL_MCKEE:
+        reorder(getReverseCuthillMcKeeOrder());
+        break;
+    case Ordering::SHAPE_KEYS:
+        break;
+    }
+}
+
+void ShapeGraphCSR::makeStates(const std::vector<Connector> &connectors) {
+    const size_t lineCount = m_refs.size();
+    m_axialRefs.resize(lineCount);
+    for (size_t line = 0; line < lineCount; line++) {
+        m_axialRefs[line] = connectors[line].segmentAxialref;
+    }
+    m_stateOffsets.resize(lineCount * 2 + 1);
+    m_stateOffsets[0] = 0;
+    for (size_t line = 0; line < lineCount; line++) {
+        // going backwards leaves through the back connections, forwards through the forward ones
+        for (bool forwards : {false, true}) {
+            const auto &segconns =
+                forwards ? connectors[line].forwardSegconns : connectors[line].backSegconns;
+            for (const auto &segconn : segconns) {
+                if (segconn.first.ref < 0 || static_cast<size_t>(segconn.first.ref) >= lineCount) {
+                    continue;
+                }
+                m_stateLinks.push_back(
+                    getState(static_cast<uint32_t>(segconn.first.ref), segconn.first.dir == 1));
+                m_stateWeights.push_back(segconn.second);
+            }
+            m_stateOffsets[getState(static_cast<uint32_t>(line), forwards) + 1] =
+                static_cast<uint32_t>(m_stateLinks.size());
+        }
+    }
+}
+
+std::vector<uint32_t> ShapeGraphCSR::getReverseCuthillMcKeeOrder() const {
+    const auto lineCount = static_cast<uint32_t>(m_refs.size());
+    std::vector<uint32_t> byConnectivity(lineCount);
+    std::iota(byConnectivity.begin(), byConnectivity.end(), 0);
+    auto fewerConnections = [&](uint32_t a, uint32_t b) {
+        return getConnectivity(a) < getConnectivity(b);
+    };
+    std::stable_sort(byConnectivity.begin(), byConnectivity.end(), fewerConnections);
+
+    std::vector<uint32_t> order;
+    order.reserve(lineCount);
+    std::vector<bool> placed(lineCount, false);
+    std::vector<uint32_t> next;
+    for (uint32_t start : byConnectivity) {
+        if (placed[start]) {
+            continue;
+        }
+        // breadth first through this part of the graph, taking the connections of every line
+        // with the fewest connections first
+        placed[start] = true;
+        order.push_back(start);
+        for (size_t head = order.size() - 1; head < order.size(); head++) {
+            next.clear();
+            for (auto it = connectionsBegin(order[head]); it != connectionsEnd(order[head]);
+                 ++it) {
+                if (!placed[*it]) {
+                    placed[*it] = true;
+                    next.push_back(*it);
+                }
+            }
+            std::stable_sort(next.begin(), next.end(), fewerConnections);
+            order.insert(order.end(), next.begin(), next.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+void ShapeGraphCSR::reorder(const std::vector<uint32_t> &order) {
+    const size_t lineCount = m_refs.size();
+    if (order.size() != lineCount) {
+        return;
+    }
+    std::vector<uint32_t> newLines(lineCount);
+    for (size_t line = 0; line < lineCount; line++) {
+        newLines[order[line]] = static_cast<uint32_t>(line);
+    }
+
+    // the keys are in order before reordering, so the line of every key is its new number
+    m_keys = m_refs;
+    m_keyLines = newLines;
+
+    auto permute = [&](auto &values) {
+        auto old = values;
+        for (size_t line = 0; line < lineCount; line++) {
+            values[line] = old[order[line]];
+        }
+    };
+    permute(m_refs);
+    permute(m_lengths);
+    if (!m_axialRefs.empty()) {
+        permute(m_axialRefs);
+    }
+
+    // the connections of every line stay in the order they were in, so that a search goes
+    // through them in the same order
+    std::vector<uint32_t> offsets(lineCount + 1), connections;
+    connections.reserve(m_connections.size());
+    offsets[0] = 0;
+    for (size_t line = 0; line < lineCount; line++) {
+        for (auto it = connectionsBegin(order[line]); it != connectionsEnd(order[line]); ++it) {
+            connections.push_back(newLines[*it]);
+        }
+        offsets[line + 1] = static_cast<uint32_t>(connections.size());
+    }
+    m_offsets = std::move(offsets);
+    m_connections = std::move(connections);
+
+    if (!hasStates()) {
+        return;
+    }
+    std::vector<uint32_t> stateOffsets(lineCount * 2 + 1), stateLinks;
+    std::vector<float> stateWeights;
+    stateLinks.reserve(m_stateLinks.size());
+    stateWeights.reserve(m_stateWeights.size());
+    stateOffsets[0] = 0;
+    for (size_t line = 0; line < lineCount; line++) {
+        for (bool forwards : {false, true}) {
+            const uint32_t oldState = getState(order[line], forwards);
+            for (uint32_t link = m_stateOffsets[oldState]; link < m_stateOffsets[oldState + 1];
+                 link++) {
+                const uint32_t target = m_stateLinks[link];
+                stateLinks.push_back(getState(newLines[getStateLine(target)], target % 2 == 1));
+                stateWeights.push_back(m_stateWeights[link]);
+            }
+            stateOffsets[getState(static_cast<uint32_t>(line), forwards) + 1] =
+                static_cast<uint32_t>(stateLinks.size());
+        }
+    }
+    m_stateOffsets = std::move(stateOffsets);
+    m_stateLinks = std::move(stateLinks);
+    m_stateWeights = std::move(stateWeights);
+}
@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// A flat copy of the connections of a ShapeGraph. The lines are numbered in
+// the order of the connectors (and so of the shapes) and their connections
+// are kept in compressed sparse rows, so that an analysis can walk the graph
+// without going through the connector of every line. On segment maps every
+// line is also two states, one for going along it either way, linked to the
+// states they turn into along with the weight of the turn. The lines may
+// instead be numbered along a Hilbert curve through their centroids or in
+// reverse Cuthill-McKee order over their connections, so that the lines a
+// search goes through one after the other are close together in memory. The
+// shape keys are then kept in order on the side to find the lines by
+
+#pragma once
+
+#include "salalib/shapegraph.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class ShapeGraphCSR {
+  public:
+    static constexpr uint32_t NO_LINE = static_cast<uint32_t>(-1);
+
+    // the state of going backwards along a line, forwards is the one after it
+    static uint32_t getState(uint32_t line, bool forwards) {
+        return line * 2 + (forwards ? 1 : 0);
+    }
+    static uint32_t getStateLine(uint32_t state) { return state / 2; }
+
+    enum class Ordering { SHAPE_KEYS, HILBERT, REVERSE_CUTHILL_MCKEE };
+
+  private:
+    std::vector<int> m_refs;         // line -> shape key
+    std::vector<float> m_lengths;    // line -> length
+    std::vector<int> m_axialRefs;    // segment -> axial line it was cut from
+    std::vector<uint32_t> m_offsets; // line -> first connection (one past the end for the last)
+    std::vector<uint32_t> m_connections;
+    std::vector<uint32_t> m_stateOffsets; // as above for the states of segment maps
+    std::vector<uint32_t> m_stateLinks;
+    std::vector<float> m_stateWeights; // 1 for a right angle
+    // the shape keys in order and the line of each, only when the lines are in another order
+    std::vector<int> m_keys;
+    std::vector<uint32_t> m_keyLines;
+
+    void makeStates(const std::vector<Connector> &connectors);
+    // lines with fewer connections first, from a line with the fewest in every part of the graph
+    std::vector<uint32_t> getReverseCuthillMcKeeOrder() const;
+    // numbers the lines again, order[line] being the line that goes there
+    void reorder(const std::vector<uint32_t> &order);
+
+  public:
+    ShapeGraphCSR() {}
+    ShapeGraphCSR(ShapeGraph &map, Ordering ordering = Ordering::SHAPE_KEYS);
+
+    bool empty() const { return m_refs.empty(); }
+    size_t getLineCount() const { return m_refs.size(); }
+    size_t getLinkCount() const { return m_connections.size(); }
+
+    int getRef(uint32_t line) const { return m_refs[line]; }
+    uint32_t getLine(int ref) const {
+        const auto &keys = isReordered() ? m_keys : m_refs;
+        auto it = std::lower_bound(keys.begin(), keys.end(), ref);
+        if (it == keys.end() || *it != ref) {
+            return NO_LINE;
+        }
+        auto index = static_cast<uint32_t>(it - keys.begin());
+        return isReordered() ? m_keyLines[index] : index;
+    }
+    // not in the order of the shape keys
+    bool isReordered() const { return !m_keyLines.empty(); }
+    float getLength(uint32_t line) const { return m_lengths[line]; }
+    int getAxialRef(uint32_t line) const { return m_axialRefs[line]; }
+
+    uint32_t getConnectivity(uint32_t line) const {
+        return m_offsets[line + 1] - m_offsets[line];
+    }
+    const uint32_t *connectionsBegin(uint32_t line) const {
+        return m_connections.data() + m_offsets[line];
+    }
+    const uint32_t *connectionsEnd(uint32_t line) const {
+        return m_connections.data() + m_offsets[line + 1];
+    }
+
+    bool hasStates() const { return !m_stateOffsets.empty(); }
+    size_t getStateCount() const { return m_refs.size() * 2; }
+    uint32_t getStateLinkOffset(uint32_t state) const { return m_stateOffsets[state]; }
+    uint32_t getStateLinkEnd(uint32_t state) const { return m_stateOffsets[state + 1]; }
+    uint32_t getStateLink(uint32_t link) const { return m_stateLinks[link]; }
+    float getStateWeight(uint32_t link) const { return m_stateWeights[link]; }
+    const std::vector<float> &getStateWeights() const { return m_stateWeights; }
+};
@@ -7,6 +7,9 @@
 #include "shapegraphdm.hpp"
 
 void ShapeGraphDM::makeConnections(const KeyVertices &keyvertices) {
+    clearDepthStore();
+    clearMetricHierarchy();
+    clearRouteGraph();
     getInternalMap().makeConnections(keyvertices);
     m_displayedAttribute = -1; // <- override if it's already showing
     auto connCol =
@@ -16,6 +19,9 @@ void ShapeGraphDM::makeConnections(const KeyVertices &keyvertices) {
 }
 
 void ShapeGraphDM::unlinkFromShapeMap(const ShapeMap &shapemap) {
+    clearDepthStore();
+    clearMetricHierarchy();
+    clearRouteGraph();
     getInternalMap().unlinkFromShapeMap(shapemap);
 
     // reset displayed attribute if it happens to be "Connectivity":
@@ -29,6 +35,9 @@ void ShapeGraphDM::unlinkFromShapeMap(const ShapeMap &shapemap) {
 }
 
 void ShapeGraphDM::makeSegmentConnections(std::vector<Connector> &connectionset) {
+    clearDepthStore();
+    clearMetricHierarchy();
+    clearRouteGraph();
     getInternalMap().makeSegmentConnections(connectionset);
 
     m_displayedAttribute = -2; // <- override if it's already showing
@@ -39,6 +48,9 @@ void ShapeGraphDM::makeSegmentConnections(std::vector<Connector> &connectionset)
 }
 
 bool ShapeGraphDM::read(std::istream &stream) {
+    clearDepthStore();
+    clearMetricHierarchy();
+    clearRouteGraph();
 
     bool read = getInternalMap().readShapeGraphData(stream);
     // now base class read:
@@ -47,6 +59,21 @@ bool ShapeGraphDM::read(std::istream &stream) {
     return read;
 }
 
+RouteGraph &ShapeGraphDM::getRouteGraph() {
+    if (m_routeGraph && m_routeGraph->getRevision() != getRevision()) {
+        // not every edit changes the graph, and the fingerprint costs less than making it again
+        if (m_routeGraph->matches(getInternalMap())) {
+            m_routeGraph->setRevision(getRevision());
+        } else {
+            m_routeGraph.reset();
+        }
+    }
+    if (!m_routeGraph) {
+        m_routeGraph = std::make_unique<RouteGraph>(getInternalMap(), getRevision());
+    }
+    return *m_routeGraph;
+}
+
 bool ShapeGraphDM::write(std::ostream &stream) {
     bool written = getInternalMap().writeShapeGraphData(stream);
 
@@ -8,12 +8,32 @@
 
 #pragma once
 
+#include "axialdepthstore.hpp"
+#include "progressivecolumn.hpp"
+#include "routegraph.hpp"
+#include "segmentmetrichierarchy.hpp"
+#include "shapegraphcsr.hpp"
 #include "shapemapdm.hpp"
 
 #include "salalib/shapegraph.hpp"
 
+#include <memory>
+
 class ShapeGraphDM : public ShapeMapDM {
 
+    // step depths between all the lines of an axial map, for the step depth of selections. It is
+    // checked against the connections before every use and dropped when they are made again
+    std::unique_ptr<AxialDepthStore> m_depthStore;
+    // the same for the metric distances between the segments of a segment map
+    std::unique_ptr<SegmentMetricHierarchy> m_metricHierarchy;
+    // the graph the routes and catchments go over, made again when an edit has changed it
+    std::unique_ptr<RouteGraph> m_routeGraph;
+    // the order the lines are numbered in for the analyses that walk a copy of the graph
+    ShapeGraphCSR::Ordering m_analysisOrdering = ShapeGraphCSR::Ordering::SHAPE_KEYS;
+    // the values an analysis is publishing while it runs, for the renderer to show until they
+    // reach the attribute table. Swapped atomically, as the analysis runs on a thread of its own
+    std::shared_ptr<ProgressiveColumn> m_progressiveColumn;
+
   public:
     ShapeGraphDM(std::unique_ptr<ShapeGraph> &&map) : ShapeMapDM(std::move(map)) {}
 
@@ -34,4 +54,30 @@ class ShapeGraphDM : public ShapeMapDM {
 
     auto isSegmentMap() { return getInternalMap().isSegmentMap(); }
     auto isAllLineMap() { return getInternalMap().isAllLineMap(); }
+
+    const AxialDepthStore *getDepthStore() const { return m_depthStore.get(); }
+    void setDepthStore(std::unique_ptr<AxialDepthStore> &&depthStore) {
+        m_depthStore = std::move(depthStore);
+    }
+    void clearDepthStore() { m_depthStore.reset(); }
+
+    const SegmentMetricHierarchy *getMetricHierarchy() const { return m_metricHierarchy.get(); }
+    void setMetricHierarchy(std::unique_ptr<SegmentMetricHierarchy> &&metricHierarchy) {
+        m_metricHierarchy = std::move(metricHierarchy);
+    }
+    void clearMetricHierarchy() { m_metricHierarchy.reset(); }
+
+    RouteGraph &getRouteGraph();
+    void clearRouteGraph() { m_routeGraph.reset(); }
+
+    ShapeGraphCSR::Ordering getAnalysisOrdering() const { return m_analysisOrdering; }
+    void setAnalysisOrdering(ShapeGraphCSR::Ordering ordering) { m_analysisOrdering = ordering; }
+
+    // null when no analysis is publishing
+    std::shared_ptr<const ProgressiveColumn> getProgressiveColumn() const {
+        return std::atomic_load(&m_progressiveColumn);
+    }
+    void setProgressiveColumn(std::shared_ptr<ProgressiveColumn> progressiveColumn) {
+        std::atomic_store(&m_progressiveColumn, std::move(progressiveColumn));
+    }
 };
@@ -10,6 +10,7 @@
 void ShapeMapDM::init(size_t size, const Region4f &r) {
     m_displayShapes.clear();
     getInternalMap().init(size, r);
+    m_revision++;
 }
 
 double ShapeMapDM::getDisplayMinValue() const {
@@ -71,6 +72,7 @@ void ShapeMapDM::clearAll() {
     m_undobuffer.clear();
     getInternalMap().clearAll();
     m_displayedAttribute = -1;
+    m_revision++;
 }
 
 int ShapeMapDM::makePointShape(const Point2f &point, bool tempshape,
@@ -87,6 +89,7 @@ bool ShapeMapDM::read(std::istream &stream) {
     std::tie(read, m_editable, m_show, m_displayedAttribute) = getInternalMap().read(stream);
 
     m_undobuffer.clear();
+    m_revision++;
 
     invalidateDisplayedAttribute();
     setDisplayedAttribute(m_displayedAttribute);
@@ -165,6 +168,7 @@ int ShapeMapDM::makePointShapeWithRef(const Point2f &point, int shapeRef, bool t
     if (!tempshape) {
         m_newshape = true;
     }
+    m_revision++;
     return newShapeRef;
 }
 
@@ -184,6 +188,7 @@ int ShapeMapDM::makeLineShapeWithRef(const Line4f &line, int shapeRef, bool thro
     }
     int newShapeRef = getInternalMap().makeLineShapeWithRef(line, shapeRef, throughUi, tempshape,
                                                             extraAttributes);
+    m_revision++;
 
     if (!tempshape) {
         m_newshape = true;
@@ -213,6 +218,7 @@ int ShapeMapDM::makePolyShapeWithRef(const std::vector<Point2f> &points, bool op
     if (!tempshape) {
         m_newshape = true;
     }
+    m_revision++;
     return newShapeRef;
 }
 
@@ -220,6 +226,7 @@ int ShapeMapDM::makeShape(const SalaShape &poly, int overrideShapeRef,
                           const std::map<size_t, float> &extraAttributes) {
     int shapeRef = getInternalMap().makeShape(poly, overrideShapeRef, extraAttributes);
     m_newshape = true;
+    m_revision++;
     return shapeRef;
 }
 
@@ -228,6 +235,7 @@ int ShapeMapDM::makeShape(const SalaShape &poly, int overrideShapeRef,
 int ShapeMapDM::makeShapeFromPointSet(const LatticeMapDM &map) {
     int shapeRef = getInternalMap().makeShapeFromPointSet(map.getInternalMap(), map.getSelSet());
     m_newshape = true;
+    m_revision++;
     return shapeRef;
 }
 
@@ -244,6 +252,7 @@ bool ShapeMapDM::moveShape(int shaperef, const Line4f &line, bool undoing) {
     }
 
     bool moved = getInternalMap().moveShape(shaperef, line);
+    m_revision++;
 
     if (getInternalMap().hasGraph()) {
         // update displayed attribute for any changes:
@@ -255,6 +264,7 @@ bool ShapeMapDM::moveShape(int shaperef, const Line4f &line, bool undoing) {
 
 int ShapeMapDM::polyBegin(const Line4f &line) {
     auto newShapeRef = getInternalMap().polyBegin(line);
+    m_revision++;
 
     // update displayed attribute
     invalidateDisplayedAttribute();
@@ -270,12 +280,17 @@ int ShapeMapDM::polyBegin(const Line4f &line) {
 }
 
 bool ShapeMapDM::polyAppend(int shapeRef, const Point2f &point) {
+    m_revision++;
     return getInternalMap().polyAppend(shapeRef, point);
 }
-bool ShapeMapDM::polyClose(int shapeRef) { return getInternalMap().polyClose(shapeRef); }
+bool ShapeMapDM::polyClose(int shapeRef) {
+    m_revision++;
+    return getInternalMap().polyClose(shapeRef);
+}
 
 bool ShapeMapDM::polyCancel(int shapeRef) {
     bool polyCancelled = getInternalMap().polyCancel(shapeRef);
+    m_revision++;
 
     m_undobuffer.pop_back();
     // update displayed attribute
@@ -316,6 +331,7 @@ void ShapeMapDM::removeShape(int shaperef, bool undoing) {
     }
 
     getInternalMap().removeShape(shaperef);
+    m_revision++;
 
     m_invalidate = true;
     m_newshape = true;
@@ -422,6 +438,7 @@ void ShapeMapDM::undo() {
 
 void ShapeMapDM::makeShapeConnections() {
     getInternalMap().makeShapeConnections();
+    m_revision++;
 
     m_displayedAttribute = -1; // <- override if it's already showing
     auto connCol = getInternalMap().getAttributeTable().getColumnIndex("Connectivity");
@@ -452,6 +469,7 @@ bool ShapeMapDM::linkShapes(const Point2f &p) {
     if (m_selectionSet.size() != 1) {
         return false;
     }
+    m_revision++;
     return getInternalMap().linkShapes(p, *m_selectionSet.begin());
 }
 
@@ -460,6 +478,7 @@ bool ShapeMapDM::unlinkShapes(const Point2f &p) {
         return false;
     }
     clearSel();
+    m_revision++;
     return getInternalMap().unlinkShapes(p, *m_selectionSet.begin());
 }
 
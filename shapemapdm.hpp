@@ -34,6 +34,10 @@ class ShapeMapDM : public AttributeMapDM {
 
     std::vector<SalaEvent> m_undobuffer;
 
+    // goes up with every edit of the shapes or their connections, so that whatever is made from
+    // them can tell when it might be out of date
+    size_t m_revision = 0;
+
   private:
     void moveData(ShapeMapDM &other) {
         getInternalMap().moveData(other.getInternalMap());
@@ -201,6 +205,8 @@ class ShapeMapDM : public AttributeMapDM {
 
     bool canUndo() const { return m_undobuffer.size() != 0; }
 
+    size_t getRevision() const { return m_revision; }
+
     // Simple wrappers
     auto &getName() { return getInternalMap().getName(); }
     const auto &getName() const { return getInternalMap().getName(); }
@@ -216,9 +222,11 @@ class ShapeMapDM : public AttributeMapDM {
     }
     const auto &getAllShapes() const { return getInternalMap().getAllShapes(); }
     auto linkShapesFromRefs(int ref1, int ref2) {
+        m_revision++;
         return getInternalMap().linkShapesFromRefs(ref1, ref2);
     }
     auto unlinkShapesFromRefs(int ref1, int ref2) {
+        m_revision++;
         return getInternalMap().unlinkShapesFromRefs(ref1, ref2);
     }
     auto getShapesInRegion(const Region4f &r) const {
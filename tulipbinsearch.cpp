@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tulipbinsearch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define TULIPBINSEARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+    // the links from begin to count that lead to states neither settled nor reached at a depth
+    // as low, and below depthEnd, go to improving. Returns how many there are
+    size_t findImprovingScalar(const uint32_t *to, const uint32_t *candidates, size_t begin,
+                               size_t count, const uint32_t *reachedIn, const uint32_t *settledIn,
+                               const uint32_t *depth, uint32_t run, uint32_t depthEnd,
+                               uint32_t *improving) {
+        size_t found = 0;
+        for (size_t k = begin; k < count; k++) {
+            const uint32_t next = to[k];
+            if (settledIn[next] != run && candidates[k] < depthEnd &&
+                (reachedIn[next] != run || candidates[k] < depth[next])) {
+                improving[found++] = static_cast<uint32_t>(k);
+            }
+        }
+        return found;
+    }
+
+#ifdef TULIPBINSEARCH_X86
+    // eight links at a time, with the stamps and depths of the states they lead to gathered
+    __attribute__((target("avx2"))) size_t
+    findImprovingAVX2(const uint32_t *to, const uint32_t *candidates, size_t count,
+                      const uint32_t *reachedIn, const uint32_t *settledIn, const uint32_t *depth,
+                      uint32_t run, uint32_t depthEnd, uint32_t *improving) {
+        const __m256i runs = _mm256_set1_epi32(static_cast<int>(run));
+        const __m256i ends = _mm256_set1_epi32(static_cast<int>(depthEnd));
+        const auto *reachedWords = reinterpret_cast<const int *>(reachedIn);
+        const auto *settledWords = reinterpret_cast<const int *>(settledIn);
+        const auto *depthWords = reinterpret_cast<const int *>(depth);
+        size_t found = 0;
+        size_t k = 0;
+        for (; k + 8 <= count; k += 8) {
+            __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(to + k));
+            __m256i candidate =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(candidates + k));
+            __m256i settled =
+                _mm256_cmpeq_epi32(_mm256_i32gather_epi32(settledWords, next, 4), runs);
+            __m256i reached =
+                _mm256_cmpeq_epi32(_mm256_i32gather_epi32(reachedWords, next, 4), runs);
+            __m256i reachedDepth = _mm256_i32gather_epi32(depthWords, next, 4);
+            // unsigned a >= b where max(a, b) is a
+            __m256i notLess =
+                _mm256_cmpeq_epi32(_mm256_max_epu32(candidate, reachedDepth), candidate);
+            __m256i beyond = _mm256_cmpeq_epi32(_mm256_max_epu32(candidate, ends), candidate);
+            __m256i rejected = _mm256_or_si256(
+                _mm256_or_si256(settled, beyond), _mm256_and_si256(reached, notLess));
+            auto kept = static_cast<unsigned>(
+                            ~_mm256_movemask_ps(_mm256_castsi256_ps(rejected))) &
+                        0xffu;
+            for (; kept; kept &= kept - 1) {
+                improving[found++] = static_cast<uint32_t>(k) +
+                                     static_cast<uint32_t>(__builtin_ctz(kept));
+            }
+        }
+        return found + findImprovingScalar(to, candidates, k, count, reachedIn, settledIn, depth,
+                                           run, depthEnd, improving + found);
+    }
+#endif
+} // namespace
+
+TulipBinSearch::Kernel TulipBinSearch::detectKernel() {
+#ifdef TULIPBINSEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernel::AVX2;
+    }
+#endif
+    return Kernel::SCALAR;
+}
+
+std::vector<uint32_t> TulipBinSearch::getLinkCosts(const ShapeGraphCSR &graph, int tulipBins) {
+    const double binsPerRightAngle = getBinsPerRightAngle(tulipBins);
+    const auto &weights = graph.getStateWeights();
+    std::vector<uint32_t> costs(weights.size());
+    for (size_t link = 0; link < weights.size(); link++) {
+        costs[link] = static_cast<uint32_t>(
+            std::lround(std::max(0.0, static_cast<double>(weights[link])) * binsPerRightAngle));
+    }
+    return costs;
+}
+
+TulipBinSearch::TulipBinSearch(const ShapeGraphCSR &graph, const std::vector<uint32_t> &costs,
+                               Kernel kernel)
+    : m_graph(graph), m_kernel(kernel), m_costs(costs),
+      // a state can only be queued up to the costliest turn past the bin being emptied
+      m_bins((costs.empty() ? 0 : *std::max_element(costs.begin(), costs.end())) + 1),
+      m_reachedIn(graph.getStateCount(), 0), m_settledIn(graph.getStateCount(), 0),
+      m_countedIn(graph.getLineCount(), 0), m_depth(graph.getStateCount(), 0),
+      m_metric(graph.getStateCount(), 0.0f), m_steps(graph.getStateCount(), 0),
+      m_parent(graph.getStateCount(), ShapeGraphCSR::NO_LINE),
+      m_lineParent(graph.getLineCount(), ShapeGraphCSR::NO_LINE) {
+    // never ask for more than the processor has
+    Kernel supported = detectKernel();
+    if (m_kernel == Kernel::AUTO || m_kernel > supported) {
+        m_kernel = supported;
+    }
+}
+
+void TulipBinSearch::startRun() {
+    m_run++;
+    if (m_run == 0) {
+        // the stamps have wrapped around
+        std::fill(m_reachedIn.begin(), m_reachedIn.end(), 0);
+        std::fill(m_settledIn.begin(), m_settledIn.end(), 0);
+        std::fill(m_countedIn.begin(), m_countedIn.end(), 0);
+        m_run = 1;
+    }
+}
+
+size_t TulipBinSearch::findImproving(uint32_t depthEnd) {
+    const size_t count = m_linkTo.size();
+    m_improving.resize(count);
+#ifdef TULIPBINSEARCH_X86
+    if (m_kernel == Kernel::AVX2) {
+        return findImprovingAVX2(m_linkTo.data(), m_candidates.data(), count, m_reachedIn.data(),
+                                 m_settledIn.data(), m_depth.data(), m_run, depthEnd,
+                                 m_improving.data());
+    }
+#endif
+    return findImprovingScalar(m_linkTo.data(), m_candidates.data(), 0, count, m_reachedIn.data(),
+                               m_settledIn.data(), m_depth.data(), m_run, depthEnd,
+                               m_improving.data());
+}
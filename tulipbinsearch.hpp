@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Least-angle search over the segment states of a ShapeGraphCSR, with the
+// turns rounded to whole tulip bins as in SegmentTulip. The costs of all the
+// links are worked out once per map into an array parallel to the links, so
+// a search only adds whole numbers. Every bin holds the states at that depth
+// in an array of its own, in a ring as long as the costliest turn, and the
+// states of a bin come out in any order. They are settled together, and the
+// links out of all of them are laid out side by side, so that the depths
+// they would give are compared with the depths already reached in one pass,
+// on AVX2 when the processor has it, before the few that improve are pushed.
+// The per-state values are stamped with the run they belong to, so that one
+// search can be reused for every origin without clearing. The search is
+// compiled once for every radius type, so that the loop over the links only
+// keeps the metric distance or the steps when the radius is in those
+
+#pragma once
+
+#include "shapegraphcsr.hpp"
+
+#include "salalib/radiustype.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+class TulipBinSearch {
+  public:
+    enum class Kernel { AUTO, SCALAR, AVX2 };
+    // the best kernel the running processor supports
+    static Kernel detectKernel();
+
+  private:
+    const ShapeGraphCSR &m_graph;
+    Kernel m_kernel;
+    const std::vector<uint32_t> &m_costs; // in bins, per state link
+    std::vector<std::vector<uint32_t>> m_bins;
+    std::vector<uint32_t> m_reachedIn; // the run that last reached / settled every state
+    std::vector<uint32_t> m_settledIn;
+    std::vector<uint32_t> m_countedIn; // the run that last gave every line to settle
+    std::vector<uint32_t> m_depth;
+    std::vector<float> m_metric; // from the middle of the origin to the middle of the line
+    std::vector<uint32_t> m_steps;
+    std::vector<uint32_t> m_parent;     // state -> state it was reached from
+    std::vector<uint32_t> m_lineParent; // line -> line it was first settled from
+    // the links out of the states settled together from a bin
+    std::vector<uint32_t> m_batch;      // the states taken out of the bin
+    std::vector<uint32_t> m_linkFrom;   // link -> the settled state
+    std::vector<uint32_t> m_linkTo;     // link -> the state it leads to
+    std::vector<uint32_t> m_candidates; // link -> the depth it would give
+    std::vector<uint32_t> m_improving;  // the links that give a lesser depth
+    uint32_t m_run = 0;
+
+    void startRun();
+    void relax(uint32_t state, uint32_t depth, float metric, uint32_t steps, uint32_t from,
+               size_t &queued) {
+        if (m_reachedIn[state] != m_run || depth < m_depth[state]) {
+            m_reachedIn[state] = m_run;
+            m_depth[state] = depth;
+            m_parent[state] = from;
+            m_metric[state] = metric;
+            m_steps[state] = steps;
+            m_bins[depth % m_bins.size()].push_back(state);
+            queued++;
+        }
+    }
+    // The gathered links that lead to states neither settled nor reached at a depth as low, and
+    // below depthEnd, into m_improving. Returns how many there are
+    size_t findImproving(uint32_t depthEnd);
+    template <RadiusType type, typename Settle>
+    void search(uint32_t origin, double limit, Settle &&settle);
+
+  public:
+    // the cost of every state link of the graph, for tulipBins bins in a full turn (so a quarter
+    // of that for a right angle)
+    static std::vector<uint32_t> getLinkCosts(const ShapeGraphCSR &graph, int tulipBins);
+    static double getBinsPerRightAngle(int tulipBins) { return tulipBins * 0.25; }
+
+    TulipBinSearch(const ShapeGraphCSR &graph, const std::vector<uint32_t> &costs,
+                   Kernel kernel = Kernel::AUTO);
+    Kernel getKernel() const { return m_kernel; }
+
+    // Settles every line the search can get to from the origin within the limit in order of
+    // depth in bins, and calls settle(line, depth) for each the first time it gets to either of
+    // its states. The limit is of the radius type, in bins when angular (and none for NONE)
+    template <typename Settle>
+    void run(uint32_t origin, RadiusType radiusType, double limit, Settle &&settle);
+
+    // the line a line of the last run was first settled from, so that the least angle tree can
+    // be walked from the bottom up (NO_LINE for the origin)
+    uint32_t getParent(uint32_t line) const { return m_lineParent[line]; }
+};
+
+template <typename Settle>
+void TulipBinSearch::run(uint32_t origin, RadiusType radiusType, double limit, Settle &&settle) {
+    switch (radiusType) {
+    case RadiusType::ANGULAR:
+        search<RadiusType::ANGULAR>(origin, limit, settle);
+        break;
+    case RadiusType::METRIC:
+        search<RadiusType::METRIC>(origin, limit, settle);
+        break;
+    case RadiusType::TOPOLOGICAL:
+        search<RadiusType::TOPOLOGICAL>(origin, limit, settle);
+        break;
+    case RadiusType::NONE:
+        search<RadiusType::NONE>(origin, limit, settle);
+        break;
+    }
+}
+
+template <RadiusType type, typename Settle>
+void TulipBinSearch::search(uint32_t origin, double limit, Settle &&settle) {
+    startRun();
+    size_t queued = 0;
+    relax(ShapeGraphCSR::getState(origin, false), 0, 0.0f, 0, ShapeGraphCSR::NO_LINE, queued);
+    relax(ShapeGraphCSR::getState(origin, true), 0, 0.0f, 0, ShapeGraphCSR::NO_LINE, queued);
+    // only the angular radius is in bins, the depths of the others go as far as they can
+    uint32_t depthEnd = std::numeric_limits<uint32_t>::max();
+    if constexpr (type == RadiusType::ANGULAR) {
+        if (limit < 0.0) {
+            depthEnd = 0;
+        } else if (limit < static_cast<double>(depthEnd)) {
+            depthEnd = static_cast<uint32_t>(limit) + 1;
+        }
+    }
+    for (uint32_t bin = 0; queued > 0; bin++) {
+        auto &states = m_bins[bin % m_bins.size()];
+        // links that go straight on cost nothing and come back to this bin, for another round
+        while (!states.empty()) {
+            m_batch.swap(states);
+            queued -= m_batch.size();
+            m_linkFrom.clear();
+            m_linkTo.clear();
+            m_candidates.clear();
+            for (uint32_t state : m_batch) {
+                if (m_settledIn[state] == m_run || m_depth[state] != bin) {
+                    continue;
+                }
+                m_settledIn[state] = m_run;
+                const uint32_t line = ShapeGraphCSR::getStateLine(state);
+                if (m_countedIn[line] != m_run) {
+                    m_countedIn[line] = m_run;
+                    m_lineParent[line] = m_parent[state] == ShapeGraphCSR::NO_LINE
+                                             ? ShapeGraphCSR::NO_LINE
+                                             : ShapeGraphCSR::getStateLine(m_parent[state]);
+                    settle(line, bin);
+                }
+                for (uint32_t link = m_graph.getStateLinkOffset(state);
+                     link < m_graph.getStateLinkEnd(state); link++) {
+                    m_linkFrom.push_back(state);
+                    m_linkTo.push_back(m_graph.getStateLink(link));
+                    m_candidates.push_back(bin + m_costs[link]);
+                }
+            }
+            m_batch.clear();
+
+            const size_t improving = findImproving(depthEnd);
+            for (size_t i = 0; i < improving; i++) {
+                const uint32_t k = m_improving[i];
+                const uint32_t from = m_linkFrom[k];
+                const uint32_t next = m_linkTo[k];
+                // only the metric radius needs the lengths of the lines
+                float nextMetric = 0.0f;
+                uint32_t steps = 0;
+                if constexpr (type == RadiusType::METRIC) {
+                    nextMetric =
+                        m_metric[from] +
+                        m_graph.getLength(ShapeGraphCSR::getStateLine(from)) * 0.5f +
+                        m_graph.getLength(ShapeGraphCSR::getStateLine(next)) * 0.5f;
+                    if (nextMetric > limit) {
+                        continue;
+                    }
+                } else if constexpr (type == RadiusType::TOPOLOGICAL) {
+                    steps = m_steps[from] + 1;
+                    if (steps > limit) {
+                        continue;
+                    }
+                }
+                relax(next, m_candidates[k], nextMetric, steps, from, queued);
+            }
+        }
+    }
+}
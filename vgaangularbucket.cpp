@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgaangularbucket.hpp"
+
+#include "angularbucketsearch.hpp"
+#include "attributecolumntransaction.hpp"
+#include "vgageometry.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/vgamodules/vgaangular.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace {
+    struct RadiusSums {
+        size_t count = 0;
+        double depth = 0.0;
+    };
+
+    // values per radius: mean depth, total depth and node count
+    constexpr size_t VALUES_PER_RADIUS = 3;
+} // namespace
+
+bool VGAAngularBucket::run(Communicator *comm) {
+    if (m_radiusSet.empty()) {
+        return false;
+    }
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    const auto &region = m_map.getRegion();
+
+    // radius n (-1) goes last, as it includes everything
+    std::vector<double> radii(m_radiusSet.begin(), m_radiusSet.end());
+    std::vector<double> limits;
+    for (double radius : radii) {
+        limits.push_back(radius < 0 ? std::numeric_limits<double>::infinity() : radius);
+    }
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+        std::rotate(limits.begin(), limits.begin() + 1, limits.end());
+    }
+
+    WorkStealingPool pool(m_threadCount);
+    std::vector<std::unique_ptr<AngularBucketSearch>> searches(pool.getThreadCount());
+    const size_t valuesPerCell = radii.size() * VALUES_PER_RADIUS;
+    std::vector<float> values(static_cast<size_t>(cellCount) * valuesPerCell, -1.0f);
+
+    pool.parallelFor(
+        cellCount,
+        [&](size_t index, size_t worker) {
+            auto origin = static_cast<uint32_t>(index);
+            if (!searches[worker]) {
+                searches[worker] = std::make_unique<AngularBucketSearch>(m_graph, locations);
+            }
+            float *cellValues = &values[index * valuesPerCell];
+            // as in VGAAngular no path may leave the radius, so the least-angle path to a point
+            // within a smaller radius can be longer than within a larger one, and every radius
+            // has a search of its own
+            for (size_t r = 0; r < radii.size(); r++) {
+                RadiusSums sums;
+                auto within = [&](uint32_t cell) {
+                    return VGAGeometry::distance(locations[origin], locations[cell]) <=
+                           limits[r];
+                };
+                auto settle = [&](uint32_t cell, double depth) {
+                    if (cell != origin) {
+                        sums.count++;
+                        sums.depth += depth;
+                    }
+                };
+                searches[worker]->run({origin}, within, settle);
+
+                cellValues[r * VALUES_PER_RADIUS] =
+                    sums.count > 0
+                        ? static_cast<float>(sums.depth / static_cast<double>(sums.count))
+                        : -1.0f;
+                cellValues[r * VALUES_PER_RADIUS + 1] = static_cast<float>(sums.depth);
+                cellValues[r * VALUES_PER_RADIUS + 2] = static_cast<float>(sums.count);
+            }
+        },
+        comm);
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    using Column = VGAAngular::Column;
+    const std::vector<const char *> columns = {
+        Column::ANGULAR_MEAN_DEPTH, Column::ANGULAR_TOTAL_DEPTH, Column::ANGULAR_NODE_COUNT};
+    for (double radius : radii) {
+        for (auto column : columns) {
+            transaction.insertOrResetColumn(
+                VGAAngular::getColumnWithRadius(column, radius, region));
+        }
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> cols;
+    for (double radius : radii) {
+        for (auto column : columns) {
+            cols.push_back(transaction.getColumnIndex(
+                VGAAngular::getColumnWithRadius(column, radius, region)));
+        }
+    }
+
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+        if (row == nullptr) {
+            continue;
+        }
+        for (size_t v = 0; v < valuesPerCell; v++) {
+            row->setValue(cols[v], values[cell * valuesPerCell + v]);
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Angular visibility analysis with a bucketed least-angle search
+// (AngularBucketSearch) from every origin, for one or more radii, each radius
+// with a search of its own. The origins are shared out among threads, each
+// with a search that is reused from one radius and origin to the next, and
+// the values are written to the table once all of them are done. Gives the
+// same columns as VGAAngular
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAAngularBucket {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // -1 for radius n
+    size_t m_threadCount;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    VGAAngularBucket(LatticeMap &map, const LatticeGraphCSR &graph, std::set<double> radiusSet,
+                     size_t threadCount = 1)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)),
+          m_threadCount(threadCount) {}
+    std::string getAnalysisName() const { return "Angular Analysis (Bucket Queue)"; }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgaangulardepthbucket.hpp"
+
+#include "angularbucketsearch.hpp"
+#include "attributecolumntransaction.hpp"
+#include "vgageometry.hpp"
+
+#include "salalib/vgamodules/vgaangulardepth.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+bool VGAAngularDepthBucket::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+
+    std::vector<uint32_t> sources;
+    for (const PixelRef &ref : m_originRefs) {
+        uint32_t cell = m_graph.getCell(ref);
+        if (cell != LatticeGraphCSR::NO_CELL) {
+            sources.push_back(cell);
+        }
+    }
+    if (sources.empty()) {
+        return false;
+    }
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(VGAAngularDepth::Column::ANGULAR_STEP_DEPTH);
+    auto col = transaction.getColumnIndex(VGAAngularDepth::Column::ANGULAR_STEP_DEPTH);
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    std::vector<float> depths(cellCount, -1.0f);
+    AngularBucketSearch(m_graph, locations)
+        .run(
+            sources, [](uint32_t) { return true; },
+            [&](uint32_t cell, double depth) { depths[cell] = static_cast<float>(depth); });
+
+    if (comm && comm->IsCancelled()) {
+        throw Communicator::CancelledException();
+    }
+
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+        if (row != nullptr) {
+            row->setValue(col, depths[cell]);
+        }
+    }
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::CURRENT_RECORD, cellCount);
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Angular step depth from a set of origins as in VGAAngularDepth, with the
+// search done by an AngularBucketSearch
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAAngularDepthBucket {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<PixelRef> m_originRefs;
+
+  public:
+    VGAAngularDepthBucket(LatticeMap &map, const LatticeGraphCSR &graph,
+                          std::set<PixelRef> originRefs)
+        : m_map(map), m_graph(graph), m_originRefs(std::move(originRefs)) {}
+    std::string getAnalysisName() const { return "Angular Step Depth (Bucket Queue)"; }
+    bool run(Communicator *comm);
+};
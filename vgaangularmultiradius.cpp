@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgaangularmultiradius.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "vgageometry.hpp"
+
+#include "salalib/vgamodules/vgaangular.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace {
+    struct RadiusSums {
+        size_t count = 0;
+        double depth = 0.0;
+    };
+} // namespace
+
+bool VGAAngularMultiRadius::run(Communicator *comm) {
+    if (m_radiusSet.empty()) {
+        return false;
+    }
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    const auto &region = m_map.getRegion();
+
+    // radius n (-1) goes last, as it includes everything
+    std::vector<double> radii(m_radiusSet.begin(), m_radiusSet.end());
+    std::vector<double> limits;
+    for (double radius : radii) {
+        limits.push_back(radius < 0 ? std::numeric_limits<double>::infinity() : radius);
+    }
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+        std::rotate(limits.begin(), limits.begin() + 1, limits.end());
+    }
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    using Column = VGAAngular::Column;
+    const std::vector<const char *> columns = {
+        Column::ANGULAR_MEAN_DEPTH, Column::ANGULAR_TOTAL_DEPTH, Column::ANGULAR_NODE_COUNT};
+    for (double radius : radii) {
+        for (auto column : columns) {
+            transaction.insertOrResetColumn(
+                VGAAngular::getColumnWithRadius(column, radius, region));
+        }
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<std::vector<size_t>> cols;
+    for (double radius : radii) {
+        cols.emplace_back();
+        for (auto column : columns) {
+            cols.back().push_back(transaction.getColumnIndex(
+                VGAAngular::getColumnWithRadius(column, radius, region)));
+        }
+    }
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    // the search each cell was last reached / settled in
+    std::vector<uint32_t> visitedIn(cellCount, 0);
+    std::vector<uint32_t> settledIn(cellCount, 0);
+    uint32_t run = 0;
+    std::vector<double> depth(cellCount, 0.0);
+    std::vector<uint32_t> parent(cellCount, LatticeGraphCSR::NO_CELL);
+
+    using QueueEntry = std::pair<double, uint32_t>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    // the least-angle depths of the points within limit of the origin, over paths within it
+    auto search = [&](uint32_t origin, double limit) {
+        run++;
+        if (run == 0) {
+            // the stamps have wrapped around
+            std::fill(visitedIn.begin(), visitedIn.end(), 0);
+            std::fill(settledIn.begin(), settledIn.end(), 0);
+            run = 1;
+        }
+        auto relax = [&](uint32_t cell, double cellDepth, uint32_t from) {
+            if (VGAGeometry::distance(locations[origin], locations[cell]) > limit) {
+                return;
+            }
+            if (visitedIn[cell] != run || cellDepth < depth[cell]) {
+                visitedIn[cell] = run;
+                depth[cell] = cellDepth;
+                parent[cell] = from;
+                queue.push(QueueEntry(cellDepth, cell));
+            }
+        };
+
+        RadiusSums sums;
+        relax(origin, 0.0, LatticeGraphCSR::NO_CELL);
+        while (!queue.empty()) {
+            auto [cellDepth, cell] = queue.top();
+            queue.pop();
+            if (settledIn[cell] == run) {
+                continue;
+            }
+            settledIn[cell] = run;
+            if (cell != origin) {
+                sums.count++;
+                sums.depth += cellDepth;
+            }
+
+            for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell); ++it) {
+                double turn = parent[cell] == LatticeGraphCSR::NO_CELL
+                                  ? 0.0
+                                  : VGAGeometry::turnAngle(locations[parent[cell]],
+                                                           locations[cell], locations[*it]);
+                relax(*it, cellDepth + turn, cell);
+            }
+            uint32_t merge = m_graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL) {
+                relax(merge, cellDepth, LatticeGraphCSR::NO_CELL);
+            }
+        }
+        return sums;
+    };
+
+    for (uint32_t origin = 0; origin < cellCount; origin++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(origin)));
+        if (row == nullptr) {
+            continue;
+        }
+
+        for (size_t r = 0; r < radii.size(); r++) {
+            const RadiusSums sums = search(origin, limits[r]);
+            row->setValue(cols[r][0], sums.count > 0
+                                          ? static_cast<float>(sums.depth /
+                                                               static_cast<double>(sums.count))
+                                          : -1.0f);
+            row->setValue(cols[r][1], static_cast<float>(sums.depth));
+            row->setValue(cols[r][2], static_cast<float>(sums.count));
+        }
+
+        if (comm) {
+            if (qtimer(atime, 500)) {
+                if (comm->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                comm->CommPostMessage(Communicator::CURRENT_RECORD, origin);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
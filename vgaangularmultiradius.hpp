@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Angular visibility analysis for a whole set of radii in one pass over the
+// origins. The radius is the straight-line distance from the origin, and as
+// in VGAAngular no path may leave it, so the least-angle path to a point
+// within a smaller radius can be longer than the one within a larger. Every
+// radius therefore has a least-angle search of its own, all of them sharing
+// the same scratch space, which is stamped with the search it belongs to
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAAngularMultiRadius {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // -1 for radius n
+
+  public:
+    VGAAngularMultiRadius(LatticeMap &map, const LatticeGraphCSR &graph,
+                          std::set<double> radiusSet)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)) {}
+    std::string getAnalysisName() const { return "Angular Analysis (Multiple Radii)"; }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Small geometric helpers shared by the metric and angular lattice engines
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace VGAGeometry {
+
+    // the centres of all the cells of the graph
+    inline std::vector<Point2f> getCellLocations(const LatticeMap &map,
+                                                 const LatticeGraphCSR &graph) {
+        std::vector<Point2f> locations(graph.getCellCount());
+        for (uint32_t cell = 0; cell < graph.getCellCount(); cell++) {
+            locations[cell] = map.depixelate(graph.getRef(cell));
+        }
+        return locations;
+    }
+
+    inline double distance(const Point2f &a, const Point2f &b) {
+        return std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+    }
+
+    // the change of direction when going from -> via -> to, in units of a right
+    // angle (0 for straight on, 2 for turning back), as in the angular analyses
+    inline double turnAngle(const Point2f &from, const Point2f &via, const Point2f &to) {
+        double ax = via.x - from.x, ay = via.y - from.y;
+        double bx = to.x - via.x, by = to.y - via.y;
+        double lengths = std::sqrt((ax * ax + ay * ay) * (bx * bx + by * by));
+        if (lengths == 0.0) {
+            return 0.0;
+        }
+        double cosine = (ax * bx + ay * by) / lengths;
+        cosine = cosine > 1.0 ? 1.0 : (cosine < -1.0 ? -1.0 : cosine);
+        return std::acos(cosine) / (M_PI * 0.5);
+    }
+
+} // namespace VGAGeometry
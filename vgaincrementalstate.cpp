@@ -0,0 +1,218 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgaincrementalstate.hpp"
+
+#include "vgavisualfused.hpp"
+
+#include <algorithm>
+
+namespace {
+    // whether the cell has the same neighbours and merge in both graphs
+    bool sameLinks(const LatticeGraphCSR &oldGraph, uint32_t oldCell,
+                   const LatticeGraphCSR &newGraph, uint32_t newCell,
+                   std::vector<uint32_t> &oldNeighbours, std::vector<uint32_t> &newNeighbours) {
+        if (oldGraph.getConnectivity(oldCell) != newGraph.getConnectivity(newCell)) {
+            return false;
+        }
+        uint32_t oldMerge = oldGraph.getMerge(oldCell);
+        uint32_t newMerge = newGraph.getMerge(newCell);
+        if ((oldMerge == LatticeGraphCSR::NO_CELL) != (newMerge == LatticeGraphCSR::NO_CELL) ||
+            (newMerge != LatticeGraphCSR::NO_CELL &&
+             newGraph.getCell(oldGraph.getRef(oldMerge)) != newMerge)) {
+            return false;
+        }
+        // compared in the numbering of the new graph
+        oldNeighbours.clear();
+        for (auto it = oldGraph.neighboursBegin(oldCell); it != oldGraph.neighboursEnd(oldCell);
+             ++it) {
+            oldNeighbours.push_back(newGraph.getCell(oldGraph.getRef(*it)));
+        }
+        newNeighbours.assign(newGraph.neighboursBegin(newCell), newGraph.neighboursEnd(newCell));
+        std::sort(oldNeighbours.begin(), oldNeighbours.end());
+        std::sort(newNeighbours.begin(), newNeighbours.end());
+        return oldNeighbours == newNeighbours;
+    }
+
+    // the cells within the given number of steps from the seeds, where merged cells are at the
+    // same step as their partners
+    std::vector<bool> reach(const LatticeGraphCSR &graph, const std::vector<uint32_t> &seeds,
+                            size_t steps) {
+        std::vector<bool> reached(graph.getCellCount(), false);
+        std::vector<uint32_t> currLevel, nextLevel;
+        auto visit = [&](uint32_t cell) {
+            if (!reached[cell]) {
+                reached[cell] = true;
+                nextLevel.push_back(cell);
+            }
+            uint32_t merge = graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL && !reached[merge]) {
+                reached[merge] = true;
+                nextLevel.push_back(merge);
+            }
+        };
+        for (uint32_t seed : seeds) {
+            visit(seed);
+        }
+        for (size_t step = 0; step < steps && !nextLevel.empty(); step++) {
+            std::swap(currLevel, nextLevel);
+            nextLevel.clear();
+            for (uint32_t cell : currLevel) {
+                for (auto it = graph.neighboursBegin(cell); it != graph.neighboursEnd(cell); ++it) {
+                    if (!reached[*it]) {
+                        visit(*it);
+                    }
+                }
+            }
+        }
+        return reached;
+    }
+} // namespace
+
+VGAIncrementalState::VGAIncrementalState(std::shared_ptr<const LatticeGraphCSR> graph,
+                                         double radius, bool simpleVersion)
+    : m_graph(std::move(graph)), m_radius(radius), m_simpleVersion(simpleVersion),
+      m_columns(VGAVisualFused::getColumnNames(radius, simpleVersion)) {}
+
+void VGAIncrementalState::captureValues(const AttributeTable &attributes) {
+    if (m_valuesCaptured) {
+        return;
+    }
+    m_valuesCaptured = true;
+
+    const size_t columnCount = m_columns.size();
+    m_columnCaptured.assign(columnCount, false);
+    std::vector<size_t> cols(columnCount, 0);
+    for (size_t c = 0; c < columnCount; c++) {
+        if (attributes.hasColumn(m_columns[c])) {
+            m_columnCaptured[c] = true;
+            cols[c] = attributes.getColumnIndex(m_columns[c]);
+        }
+    }
+    m_values.assign(m_graph->getCellCount() * columnCount, -1.0f);
+    for (uint32_t cell = 0; cell < m_graph->getCellCount(); cell++) {
+        const AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph->getRef(cell)));
+        if (row == nullptr) {
+            continue;
+        }
+        for (size_t c = 0; c < columnCount; c++) {
+            if (m_columnCaptured[c]) {
+                m_values[cell * columnCount + c] = row->getValue(cols[c]);
+            }
+        }
+    }
+}
+
+std::vector<bool> VGAIncrementalState::findAffectedOrigins(
+    const LatticeGraphCSR &graph,
+    const std::optional<std::pair<PixelRef, PixelRef>> &region) const {
+    const LatticeGraphCSR &oldGraph = *m_graph;
+
+    // the cells whose links changed (or that came or went), in both numberings
+    std::vector<uint32_t> newSeeds, oldSeeds;
+    std::vector<uint32_t> oldNeighbours, newNeighbours;
+    std::vector<bool> checked(graph.getCellCount(), false);
+    auto check = [&](uint32_t cell) {
+        if (cell == LatticeGraphCSR::NO_CELL || checked[cell]) {
+            return;
+        }
+        checked[cell] = true;
+        uint32_t oldCell = oldGraph.getCell(graph.getRef(cell));
+        if (oldCell == LatticeGraphCSR::NO_CELL) {
+            newSeeds.push_back(cell);
+        } else if (!sameLinks(oldGraph, oldCell, graph, cell, oldNeighbours, newNeighbours)) {
+            newSeeds.push_back(cell);
+            oldSeeds.push_back(oldCell);
+        }
+    };
+
+    const size_t regionArea =
+        region ? static_cast<size_t>(region->second.x - region->first.x + 1) *
+                     static_cast<size_t>(region->second.y - region->first.y + 1)
+               : 0;
+    if (!region || regionArea >= graph.getCellCount()) {
+        for (uint32_t cell = 0; cell < graph.getCellCount(); cell++) {
+            check(cell);
+        }
+        for (uint32_t oldCell = 0; oldCell < oldGraph.getCellCount(); oldCell++) {
+            if (graph.getCell(oldGraph.getRef(oldCell)) == LatticeGraphCSR::NO_CELL) {
+                oldSeeds.push_back(oldCell);
+            }
+        }
+    } else {
+        // cells only ever block the view past the walls, not one another, so an edit changes the
+        // links of the edited cells and otherwise only those to them, of the cells they are or
+        // were linked or merged to. Cells only come or go when edited
+        for (auto x = region->first.x; x <= region->second.x; x++) {
+            for (auto y = region->first.y; y <= region->second.y; y++) {
+                const PixelRef pix(x, y);
+                const uint32_t cell = graph.getCell(pix);
+                if (cell != LatticeGraphCSR::NO_CELL) {
+                    check(cell);
+                    check(graph.getMerge(cell));
+                    std::for_each(graph.neighboursBegin(cell), graph.neighboursEnd(cell), check);
+                }
+                const uint32_t oldCell = oldGraph.getCell(pix);
+                if (oldCell == LatticeGraphCSR::NO_CELL) {
+                    continue;
+                }
+                if (cell == LatticeGraphCSR::NO_CELL) {
+                    oldSeeds.push_back(oldCell);
+                }
+                auto checkOld = [&](uint32_t other) {
+                    if (other != LatticeGraphCSR::NO_CELL) {
+                        check(graph.getCell(oldGraph.getRef(other)));
+                    }
+                };
+                checkOld(oldGraph.getMerge(oldCell));
+                std::for_each(oldGraph.neighboursBegin(oldCell), oldGraph.neighboursEnd(oldCell),
+                              checkOld);
+            }
+        }
+    }
+
+    // an origin's results only depend on the links of the cells it expands, i.e. those
+    // before the last level of its search, in the old graph as well as the new one
+    const size_t steps = VGAVisualFused::getSearchDepth(m_radius) - 1;
+    std::vector<bool> affected = reach(graph, newSeeds, steps);
+    std::vector<bool> oldAffected = reach(oldGraph, oldSeeds, steps);
+    for (uint32_t oldCell = 0; oldCell < oldGraph.getCellCount(); oldCell++) {
+        if (oldAffected[oldCell]) {
+            uint32_t cell = graph.getCell(oldGraph.getRef(oldCell));
+            if (cell != LatticeGraphCSR::NO_CELL) {
+                affected[cell] = true;
+            }
+        }
+    }
+    return affected;
+}
+
+void VGAIncrementalState::restoreValues(AttributeTable &attributes, const LatticeGraphCSR &graph,
+                                        const std::vector<bool> &affected) const {
+    if (!m_valuesCaptured) {
+        return;
+    }
+    const size_t columnCount = m_columns.size();
+    std::vector<size_t> cols(columnCount, 0);
+    for (size_t c = 0; c < columnCount; c++) {
+        if (m_columnCaptured[c]) {
+            cols[c] = attributes.getColumnIndex(m_columns[c]);
+        }
+    }
+    for (uint32_t cell = 0; cell < graph.getCellCount(); cell++) {
+        if (affected[cell]) {
+            continue;
+        }
+        uint32_t oldCell = m_graph->getCell(graph.getRef(cell));
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(graph.getRef(cell)));
+        if (oldCell == LatticeGraphCSR::NO_CELL || row == nullptr) {
+            continue;
+        }
+        for (size_t c = 0; c < columnCount; c++) {
+            if (m_columnCaptured[c]) {
+                row->setValue(cols[c], m_values[oldCell * columnCount + c]);
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// What the fused visual analysis of a lattice map was last run on: the graph,
+// the settings and, once the map starts to change, the values it produced.
+// When the graph has been made again, the cells whose links changed are found
+// by comparing the two graphs around the edited pixels, only the origins that can reach them within
+// the search depth are analysed again and the rest get their old values back
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/attributetable.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class VGAIncrementalState {
+    std::shared_ptr<const LatticeGraphCSR> m_graph;
+    double m_radius;
+    bool m_simpleVersion;
+    std::vector<std::string> m_columns;
+    std::vector<bool> m_columnCaptured;
+    std::vector<float> m_values; // indexed as cell * columns + column
+    bool m_valuesCaptured = false;
+
+  public:
+    VGAIncrementalState(std::shared_ptr<const LatticeGraphCSR> graph, double radius,
+                        bool simpleVersion);
+
+    double getRadius() const { return m_radius; }
+    bool isSimpleVersion() const { return m_simpleVersion; }
+    bool isGraph(const std::shared_ptr<const LatticeGraphCSR> &graph) const {
+        return m_graph == graph;
+    }
+
+    // copies the values out of the table (only the first time) before they can be changed
+    void captureValues(const AttributeTable &attributes);
+
+    // the cells of the new graph whose results can differ from those of the analysed one. With
+    // the bounds of the pixels edited since, only the cells around them are compared
+    std::vector<bool>
+    findAffectedOrigins(const LatticeGraphCSR &graph,
+                        const std::optional<std::pair<PixelRef, PixelRef>> &region) const;
+
+    // puts the captured values back for the cells that were not analysed again
+    void restoreValues(AttributeTable &attributes, const LatticeGraphCSR &graph,
+                       const std::vector<bool> &affected) const;
+};
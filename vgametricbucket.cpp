@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgametricbucket.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "metricbucketsearch.hpp"
+#include "vgageometry.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/vgamodules/vgametric.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace {
+    struct RadiusSums {
+        size_t count = 0;
+        double distance = 0.0;
+        double straightLine = 0.0;
+        double angle = 0.0;
+    };
+
+    // values per radius: angle, distance, straight-line distance and node count
+    constexpr size_t VALUES_PER_RADIUS = 4;
+} // namespace
+
+bool VGAMetricBucket::run(Communicator *comm) {
+    if (m_radiusSet.empty()) {
+        return false;
+    }
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    const auto linkLengths = MetricBucketSearch::getLinkLengths(m_graph, locations);
+    const auto &region = m_map.getRegion();
+
+    // radius n (-1) goes last, as it includes everything
+    std::vector<double> radii(m_radiusSet.begin(), m_radiusSet.end());
+    std::vector<double> limits;
+    for (double radius : radii) {
+        limits.push_back(radius < 0 ? std::numeric_limits<double>::infinity() : radius);
+    }
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+        std::rotate(limits.begin(), limits.begin() + 1, limits.end());
+    }
+    const double maxLimit = limits.back();
+
+    WorkStealingPool pool(m_threadCount);
+    std::vector<std::unique_ptr<MetricBucketSearch>> searches(pool.getThreadCount());
+    std::vector<std::vector<RadiusSums>> workerSums(pool.getThreadCount());
+    const size_t valuesPerCell = radii.size() * VALUES_PER_RADIUS;
+    std::vector<float> values(static_cast<size_t>(cellCount) * valuesPerCell, -1.0f);
+
+    pool.parallelFor(
+        cellCount,
+        [&](size_t index, size_t worker) {
+            auto origin = static_cast<uint32_t>(index);
+            if (!searches[worker]) {
+                searches[worker] =
+                    std::make_unique<MetricBucketSearch>(m_graph, locations, linkLengths);
+            }
+            auto &sums = workerSums[worker];
+            sums.assign(radii.size(), RadiusSums());
+            auto settle = [&](uint32_t cell, double dist, double cumAngle) {
+                // counted in the smallest radius it fits in, the larger ones are summed up below
+                auto radiusIdx = static_cast<size_t>(
+                    std::lower_bound(limits.begin(), limits.end(), dist) - limits.begin());
+                auto &radiusSums = sums[radiusIdx];
+                radiusSums.count++;
+                radiusSums.distance += dist;
+                radiusSums.straightLine +=
+                    VGAGeometry::distance(locations[origin], locations[cell]);
+                radiusSums.angle += cumAngle;
+            };
+            searches[worker]->run({origin}, maxLimit, settle);
+
+            RadiusSums total;
+            float *cellValues = &values[index * valuesPerCell];
+            for (size_t r = 0; r < radii.size(); r++) {
+                total.count += sums[r].count;
+                total.distance += sums[r].distance;
+                total.straightLine += sums[r].straightLine;
+                total.angle += sums[r].angle;
+                auto nodes = static_cast<double>(total.count);
+                cellValues[r * VALUES_PER_RADIUS] = static_cast<float>(total.angle / nodes);
+                cellValues[r * VALUES_PER_RADIUS + 1] = static_cast<float>(total.distance / nodes);
+                cellValues[r * VALUES_PER_RADIUS + 2] =
+                    static_cast<float>(total.straightLine / nodes);
+                cellValues[r * VALUES_PER_RADIUS + 3] = static_cast<float>(total.count);
+            }
+        },
+        comm);
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    using Column = VGAMetric::Column;
+    const std::vector<const char *> columns = {
+        Column::METRIC_MEAN_SHORTEST_PATH_ANGLE, Column::METRIC_MEAN_SHORTEST_PATH_DISTANCE,
+        Column::METRIC_MEAN_STRAIGHT_LINE_DISTANCE, Column::METRIC_NODE_COUNT};
+    for (double radius : radii) {
+        for (auto column : columns) {
+            transaction.insertOrResetColumn(VGAMetric::getColumnWithRadius(column, radius, region));
+        }
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> cols;
+    for (double radius : radii) {
+        for (auto column : columns) {
+            cols.push_back(
+                transaction.getColumnIndex(VGAMetric::getColumnWithRadius(column, radius, region)));
+        }
+    }
+
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+        if (row == nullptr) {
+            continue;
+        }
+        for (size_t v = 0; v < valuesPerCell; v++) {
+            row->setValue(cols[v], values[cell * valuesPerCell + v]);
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
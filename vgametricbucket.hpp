@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Metric visibility analysis with a bucket queue search (MetricBucketSearch)
+// from every origin, for one or more radii. The origins are shared out among
+// threads, each with a search of its own, and the values are written to the
+// table once all of them are done. Gives the same columns as VGAMetric
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAMetricBucket {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // -1 for radius n
+    size_t m_threadCount;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    VGAMetricBucket(LatticeMap &map, const LatticeGraphCSR &graph, std::set<double> radiusSet,
+                    size_t threadCount = 1)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)),
+          m_threadCount(threadCount) {}
+    std::string getAnalysisName() const { return "Metric Analysis (Bucket Queue)"; }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgametricdepthbatch.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "metricbucketsearch.hpp"
+#include "vgageometry.hpp"
+#include "workstealingpool.hpp"
+
+#include "salalib/vgamodules/vgametricdepth.hpp"
+#include "salalib/vgamodules/vgametricdepthlinkcost.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+std::vector<double> VGAMetricDepthBatch::getMergeCosts() const {
+    const auto &attributes = m_map.getAttributeTable();
+    if (!attributes.hasColumn(VGAMetricDepthLinkCost::Column::LINK_METRIC_COST)) {
+        return {};
+    }
+    auto costCol = attributes.getColumnIndex(VGAMetricDepthLinkCost::Column::LINK_METRIC_COST);
+
+    // both ways over a link cost what its first point says, nothing if it has no cost set
+    std::vector<double> mergeCosts(m_graph.getCellCount(), 0.0);
+    for (const auto &link : m_map.getMergeLines()) {
+        uint32_t a = m_graph.getCell(link.a);
+        uint32_t b = m_graph.getCell(link.b);
+        const AttributeRow *row = attributes.getRowPtr(AttributeKey(link.a));
+        if (a == LatticeGraphCSR::NO_CELL || b == LatticeGraphCSR::NO_CELL || row == nullptr) {
+            continue;
+        }
+        double cost = std::max(0.0, static_cast<double>(row->getValue(costCol)));
+        mergeCosts[a] = cost;
+        mergeCosts[b] = cost;
+    }
+    return mergeCosts;
+}
+
+bool VGAMetricDepthBatch::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+    const size_t groupCount = m_originGroups.size();
+    if (groupCount == 0) {
+        return false;
+    }
+
+    // shared by the whole batch
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    const auto linkLengths = MetricBucketSearch::getLinkLengths(m_graph, locations);
+    const auto mergeCosts = getMergeCosts();
+    const std::vector<double> *mergeCostsPtr = mergeCosts.empty() ? nullptr : &mergeCosts;
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    const std::string column = VGAMetricDepth::Column::METRIC_STEP_SHORTEST_PATH_LENGTH;
+    for (size_t g = 0; g < groupCount; g++) {
+        transaction.insertOrResetColumn(getColumnWithGroup(column, g));
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> cols(groupCount);
+    for (size_t g = 0; g < groupCount; g++) {
+        cols[g] = transaction.getColumnIndex(getColumnWithGroup(column, g));
+    }
+    std::vector<AttributeRow *> rows(cellCount);
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        rows[cell] = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+    }
+
+    WorkStealingPool pool(m_threadCount);
+    std::vector<std::unique_ptr<MetricBucketSearch>> searches(pool.getThreadCount());
+    const size_t chunkSize = pool.getThreadCount() * GROUPS_PER_THREAD;
+    const size_t chunkCount = (groupCount + chunkSize - 1) / chunkSize;
+    std::vector<std::vector<float>> lengths(std::min(chunkSize, groupCount));
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_STEPS, chunkCount);
+    }
+
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        const size_t firstGroup = chunk * chunkSize;
+        const size_t chunkGroups = std::min(chunkSize, groupCount - firstGroup);
+        if (comm) {
+            comm->CommPostMessage(Communicator::CURRENT_STEP, chunk + 1);
+        }
+
+        pool.parallelFor(
+            chunkGroups,
+            [&](size_t index, size_t worker) {
+                if (!searches[worker]) {
+                    searches[worker] = std::make_unique<MetricBucketSearch>(
+                        m_graph, locations, linkLengths, mergeCostsPtr);
+                }
+                std::vector<uint32_t> sources;
+                for (const PixelRef &ref : m_originGroups[firstGroup + index]) {
+                    uint32_t cell = m_graph.getCell(ref);
+                    if (cell != LatticeGraphCSR::NO_CELL) {
+                        sources.push_back(cell);
+                    }
+                }
+                auto &groupLengths = lengths[index];
+                groupLengths.assign(cellCount, -1.0f);
+                searches[worker]->run(sources, std::numeric_limits<double>::infinity(),
+                                      [&](uint32_t cell, double dist, double) {
+                                          groupLengths[cell] = static_cast<float>(dist);
+                                      });
+            },
+            comm);
+
+        for (uint32_t cell = 0; cell < cellCount; cell++) {
+            if (rows[cell] == nullptr) {
+                continue;
+            }
+            for (size_t index = 0; index < chunkGroups; index++) {
+                rows[cell]->setValue(cols[firstGroup + index], lengths[index][cell]);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
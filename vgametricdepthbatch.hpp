@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Metric step depth from many origin groups (every entrance of a building,
+// say), one shortest-path length column per group. The cell locations, link
+// lengths and, where the map has a VGAMetricDepthLinkCost column, the costs
+// of the merge links are worked out once for the whole batch. The groups
+// are shared out among threads, each with a MetricBucketSearch of its own
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+class VGAMetricDepthBatch {
+  public:
+    static std::string getColumnWithGroup(const std::string &column, size_t group) {
+        return column + " [Group " + std::to_string(group + 1) + "]";
+    }
+
+    // groups kept in memory per thread before their columns are written
+    static constexpr size_t GROUPS_PER_THREAD = 4;
+
+  private:
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::vector<std::set<PixelRef>> m_originGroups;
+    size_t m_threadCount;
+
+    // the merge link costs from the link cost column, empty if there is none
+    std::vector<double> getMergeCosts() const;
+
+  public:
+    // threadCount 0 for all the hardware threads
+    VGAMetricDepthBatch(LatticeMap &map, const LatticeGraphCSR &graph,
+                        std::vector<std::set<PixelRef>> originGroups, size_t threadCount = 1)
+        : m_map(map), m_graph(graph), m_originGroups(std::move(originGroups)),
+          m_threadCount(threadCount) {}
+    std::string getAnalysisName() const { return "Batched Metric Step Depth"; }
+    size_t getGroupCount() const { return m_originGroups.size(); }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgametricdepthbucket.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "metricbucketsearch.hpp"
+#include "vgageometry.hpp"
+
+#include "salalib/vgamodules/vgametricdepth.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <limits>
+
+bool VGAMetricDepthBucket::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+
+    std::vector<uint32_t> sources;
+    for (const PixelRef &ref : m_originRefs) {
+        uint32_t cell = m_graph.getCell(ref);
+        if (cell != LatticeGraphCSR::NO_CELL) {
+            sources.push_back(cell);
+        }
+    }
+    if (sources.empty()) {
+        return false;
+    }
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    using Column = VGAMetricDepth::Column;
+    transaction.insertOrResetColumn(Column::METRIC_STEP_SHORTEST_PATH_ANGLE);
+    transaction.insertOrResetColumn(Column::METRIC_STEP_SHORTEST_PATH_LENGTH);
+    transaction.insertOrResetColumn(Column::METRIC_STRAIGHT_LINE_DISTANCE);
+    // the column order might have changed while inserting, retrieve them all again:
+    auto angleCol = transaction.getColumnIndex(Column::METRIC_STEP_SHORTEST_PATH_ANGLE);
+    auto lengthCol = transaction.getColumnIndex(Column::METRIC_STEP_SHORTEST_PATH_LENGTH);
+    auto straightLineCol = transaction.getColumnIndex(Column::METRIC_STRAIGHT_LINE_DISTANCE);
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    MetricBucketSearch search(m_graph, locations,
+                              MetricBucketSearch::getLinkLengths(m_graph, locations));
+    std::vector<float> angles(cellCount, -1.0f), lengths(cellCount, -1.0f);
+    search.run(sources, std::numeric_limits<double>::infinity(),
+               [&](uint32_t cell, double dist, double cumAngle) {
+                   lengths[cell] = static_cast<float>(dist);
+                   angles[cell] = static_cast<float>(cumAngle);
+               });
+
+    if (comm && comm->IsCancelled()) {
+        throw Communicator::CancelledException();
+    }
+
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+        if (row == nullptr) {
+            continue;
+        }
+        row->setValue(angleCol, angles[cell]);
+        row->setValue(lengthCol, lengths[cell]);
+        // as in VGAMetricDepth, the straight-line distance is only there for a single origin
+        row->setValue(straightLineCol,
+                      sources.size() == 1 && lengths[cell] >= 0.0f
+                          ? static_cast<float>(
+                                VGAGeometry::distance(locations[sources.front()], locations[cell]))
+                          : -1.0f);
+    }
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::CURRENT_RECORD, cellCount);
+    }
+
+    transaction.commit();
+    return true;
+}
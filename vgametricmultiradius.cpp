@@ -0,0 +1,162 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgametricmultiradius.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "vgageometry.hpp"
+
+#include "salalib/vgamodules/vgametric.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace {
+    struct RadiusSums {
+        size_t count = 0;
+        double distance = 0.0;
+        double straightLine = 0.0;
+        double angle = 0.0;
+    };
+} // namespace
+
+bool VGAMetricMultiRadius::run(Communicator *comm) {
+    if (m_radiusSet.empty()) {
+        return false;
+    }
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+    const auto locations = VGAGeometry::getCellLocations(m_map, m_graph);
+    const auto &region = m_map.getRegion();
+
+    // radius n (-1) goes last, as it includes everything
+    std::vector<double> radii(m_radiusSet.begin(), m_radiusSet.end());
+    std::vector<double> limits;
+    for (double radius : radii) {
+        limits.push_back(radius < 0 ? std::numeric_limits<double>::infinity() : radius);
+    }
+    if (radii.front() < 0) {
+        std::rotate(radii.begin(), radii.begin() + 1, radii.end());
+        std::rotate(limits.begin(), limits.begin() + 1, limits.end());
+    }
+    const double maxLimit = limits.back();
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    using Column = VGAMetric::Column;
+    const std::vector<const char *> columns = {
+        Column::METRIC_MEAN_SHORTEST_PATH_ANGLE, Column::METRIC_MEAN_SHORTEST_PATH_DISTANCE,
+        Column::METRIC_MEAN_STRAIGHT_LINE_DISTANCE, Column::METRIC_NODE_COUNT};
+    for (double radius : radii) {
+        for (auto column : columns) {
+            transaction.insertOrResetColumn(VGAMetric::getColumnWithRadius(column, radius, region));
+        }
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<std::vector<size_t>> cols;
+    for (double radius : radii) {
+        cols.emplace_back();
+        for (auto column : columns) {
+            cols.back().push_back(
+                transaction.getColumnIndex(VGAMetric::getColumnWithRadius(column, radius, region)));
+        }
+    }
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    std::vector<uint32_t> visitedFrom(cellCount, LatticeGraphCSR::NO_CELL);
+    std::vector<uint32_t> settledFrom(cellCount, LatticeGraphCSR::NO_CELL);
+    std::vector<double> dist(cellCount, 0.0);
+    std::vector<double> cumAngle(cellCount, 0.0);
+    std::vector<uint32_t> parent(cellCount, LatticeGraphCSR::NO_CELL);
+    std::vector<RadiusSums> sums(radii.size());
+
+    using QueueEntry = std::pair<double, uint32_t>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    for (uint32_t origin = 0; origin < cellCount; origin++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(origin)));
+        if (row == nullptr) {
+            continue;
+        }
+
+        auto relax = [&](uint32_t cell, double cellDist, uint32_t from, double angle) {
+            if (cellDist > maxLimit) {
+                return;
+            }
+            if (visitedFrom[cell] != origin || cellDist < dist[cell]) {
+                visitedFrom[cell] = origin;
+                dist[cell] = cellDist;
+                parent[cell] = from;
+                cumAngle[cell] = angle;
+                queue.push(QueueEntry(cellDist, cell));
+            }
+        };
+
+        std::fill(sums.begin(), sums.end(), RadiusSums());
+        relax(origin, 0.0, LatticeGraphCSR::NO_CELL, 0.0);
+        while (!queue.empty()) {
+            auto [cellDist, cell] = queue.top();
+            queue.pop();
+            if (settledFrom[cell] == origin) {
+                continue;
+            }
+            settledFrom[cell] = origin;
+
+            // counted in the smallest radius it fits in, the larger ones are summed up below
+            auto radiusIdx = static_cast<size_t>(
+                std::lower_bound(limits.begin(), limits.end(), cellDist) - limits.begin());
+            auto &radiusSums = sums[radiusIdx];
+            radiusSums.count++;
+            radiusSums.distance += cellDist;
+            radiusSums.straightLine += VGAGeometry::distance(locations[origin], locations[cell]);
+            radiusSums.angle += cumAngle[cell];
+
+            for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell); ++it) {
+                double turn = parent[cell] == LatticeGraphCSR::NO_CELL
+                                  ? 0.0
+                                  : VGAGeometry::turnAngle(locations[parent[cell]],
+                                                           locations[cell], locations[*it]);
+                relax(*it, cellDist + VGAGeometry::distance(locations[cell], locations[*it]), cell,
+                      cumAngle[cell] + turn);
+            }
+            uint32_t merge = m_graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL) {
+                relax(merge, cellDist, LatticeGraphCSR::NO_CELL, cumAngle[cell]);
+            }
+        }
+
+        RadiusSums total;
+        for (size_t r = 0; r < radii.size(); r++) {
+            total.count += sums[r].count;
+            total.distance += sums[r].distance;
+            total.straightLine += sums[r].straightLine;
+            total.angle += sums[r].angle;
+            auto nodes = static_cast<double>(total.count);
+            row->setValue(cols[r][0], static_cast<float>(total.angle / nodes));
+            row->setValue(cols[r][1], static_cast<float>(total.distance / nodes));
+            row->setValue(cols[r][2], static_cast<float>(total.straightLine / nodes));
+            row->setValue(cols[r][3], static_cast<float>(total.count));
+        }
+
+        if (comm) {
+            if (qtimer(atime, 500)) {
+                if (comm->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                comm->CommPostMessage(Communicator::CURRENT_RECORD, origin);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
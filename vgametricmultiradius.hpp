@@ -0,0 +1,29 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Metric visibility analysis for a whole set of radii from one shortest-path
+// search per origin. The search goes out to the largest radius and every
+// point is added to the sums of the radii its shortest-path distance fits in,
+// which gives the same columns as one VGAMetric run per radius
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAMetricMultiRadius {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // -1 for radius n
+
+  public:
+    VGAMetricMultiRadius(LatticeMap &map, const LatticeGraphCSR &graph,
+                         std::set<double> radiusSet)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)) {}
+    std::string getAnalysisName() const { return "Metric Analysis (Multiple Radii)"; }
+    bool run(Communicator *comm);
+};
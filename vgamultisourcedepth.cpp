@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgamultisourcedepth.hpp"
+
+#include "attributecolumntransaction.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+    int lowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int bit = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+} // namespace
+
+bool VGAMultiSourceDepth::run(Communicator *comm) {
+    const size_t cellCount = m_graph.getCellCount();
+    const size_t groupCount = m_originGroups.size();
+    const size_t groupsPerPass = 64 * MAX_WORDS_PER_PASS;
+    const size_t passCount = (groupCount + groupsPerPass - 1) / groupsPerPass;
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    for (size_t g = 0; g < groupCount; g++) {
+        transaction.insertOrResetColumn(getColumnWithGroup(Column::VISUAL_STEP_DEPTH, g));
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    std::vector<size_t> cols(groupCount);
+    for (size_t g = 0; g < groupCount; g++) {
+        cols[g] = transaction.getColumnIndex(getColumnWithGroup(Column::VISUAL_STEP_DEPTH, g));
+    }
+    std::vector<AttributeRow *> rows(cellCount);
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        rows[cell] = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+    }
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_STEPS, passCount);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    std::vector<uint64_t> seen, visit, next;
+    for (size_t pass = 0; pass < passCount; pass++) {
+        const size_t firstGroup = pass * groupsPerPass;
+        const size_t passGroups = std::min(groupCount - firstGroup, groupsPerPass);
+        const size_t words = (passGroups + 63) / 64;
+
+        seen.assign(cellCount * words, 0);
+        visit.assign(cellCount * words, 0);
+        next.assign(cellCount * words, 0);
+
+        // writes the depth for every group with a bit set in this word
+        auto setDepth = [&](uint32_t cell, size_t word, uint64_t bits, float depth) {
+            AttributeRow *row = rows[cell];
+            if (row == nullptr) {
+                return;
+            }
+            while (bits) {
+                row->setValue(cols[firstGroup + word * 64 + static_cast<size_t>(lowestBit(bits))],
+                              depth);
+                bits &= bits - 1;
+            }
+        };
+        auto reach = [&](uint32_t cell, size_t word, uint64_t bit) {
+            if (cell != LatticeGraphCSR::NO_CELL && !(seen[cell * words + word] & bit)) {
+                seen[cell * words + word] |= bit;
+                visit[cell * words + word] |= bit;
+                setDepth(cell, word, bit, 0.0f);
+            }
+        };
+
+        for (size_t g = 0; g < passGroups; g++) {
+            const size_t word = g / 64;
+            const uint64_t bit = uint64_t(1) << (g % 64);
+            for (const PixelRef &ref : m_originGroups[firstGroup + g]) {
+                uint32_t cell = m_graph.getCell(ref);
+                if (cell == LatticeGraphCSR::NO_CELL) {
+                    continue;
+                }
+                reach(cell, word, bit);
+                reach(m_graph.getMerge(cell), word, bit);
+            }
+        }
+
+        if (comm) {
+            comm->CommPostMessage(Communicator::CURRENT_STEP, pass + 1);
+        }
+
+        size_t expanded = 0;
+        float level = 0.0f;
+        bool active = true;
+        while (active) {
+            level += 1.0f;
+            active = false;
+            std::fill(next.begin(), next.end(), 0);
+
+            for (uint32_t cell = 0; cell < cellCount; cell++) {
+                const uint64_t *cellVisit = &visit[cell * words];
+                bool inFrontier = false;
+                for (size_t w = 0; w < words; w++) {
+                    inFrontier |= cellVisit[w] != 0;
+                }
+                if (!inFrontier) {
+                    continue;
+                }
+                expanded++;
+                for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell);
+                     ++it) {
+                    uint64_t *otherSeen = &seen[*it * words];
+                    uint64_t *otherNext = &next[*it * words];
+                    for (size_t w = 0; w < words; w++) {
+                        uint64_t diff = cellVisit[w] & ~otherSeen[w];
+                        otherNext[w] |= diff;
+                        otherSeen[w] |= diff;
+                    }
+                }
+            }
+
+            // merged cells are reached at the same depth as their partner
+            for (uint32_t cell = 0; cell < cellCount; cell++) {
+                uint32_t merge = m_graph.getMerge(cell);
+                if (merge == LatticeGraphCSR::NO_CELL) {
+                    continue;
+                }
+                for (size_t w = 0; w < words; w++) {
+                    uint64_t diff = next[cell * words + w] & ~seen[merge * words + w];
+                    next[merge * words + w] |= diff;
+                    seen[merge * words + w] |= diff;
+                }
+            }
+
+            for (uint32_t cell = 0; cell < cellCount; cell++) {
+                for (size_t w = 0; w < words; w++) {
+                    uint64_t bits = next[cell * words + w];
+                    if (bits) {
+                        active = true;
+                        setDepth(cell, w, bits, level);
+                    }
+                }
+            }
+            std::swap(visit, next);
+
+            if (comm) {
+                if (qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        throw Communicator::CancelledException();
+                    }
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD,
+                                          std::min(expanded, cellCount));
+                }
+            }
+        }
+
+        // cells a group never reaches are marked as such
+        for (uint32_t cell = 0; cell < cellCount; cell++) {
+            for (size_t w = 0; w < words; w++) {
+                uint64_t mask = ~uint64_t(0);
+                if (w == words - 1 && passGroups % 64 != 0) {
+                    mask = (uint64_t(1) << (passGroups % 64)) - 1;
+                }
+                setDepth(cell, w, ~seen[cell * words + w] & mask, -1.0f);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
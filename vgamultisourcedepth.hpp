@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Visual step depth from many origin groups at once. All groups are carried
+// through a single breadth-first traversal as bits of a frontier word (one
+// bit per group), and every group gets its own step depth column
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+#include <string>
+#include <vector>
+
+class VGAMultiSourceDepth {
+  public:
+    struct Column {
+        static constexpr const char *VISUAL_STEP_DEPTH = "Visual Step Depth";
+    };
+    static std::string getColumnWithGroup(const std::string &column, size_t group) {
+        return column + " [Group " + std::to_string(group + 1) + "]";
+    }
+
+    // number of 64-bit frontier words handled by one traversal; groups beyond
+    // this are processed in further traversals
+    static constexpr size_t MAX_WORDS_PER_PASS = 4;
+
+  private:
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::vector<std::set<PixelRef>> m_originGroups;
+
+  public:
+    VGAMultiSourceDepth(LatticeMap &map, const LatticeGraphCSR &graph,
+                        std::vector<std::set<PixelRef>> originGroups)
+        : m_map(map), m_graph(graph), m_originGroups(std::move(originGroups)) {}
+    std::string getAnalysisName() const { return "Multi-source Visual Step Depth"; }
+    size_t getGroupCount() const { return m_originGroups.size(); }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,285 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgasampleddepth.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "bitmapfrontierbfs.hpp"
+#include "vgageometry.hpp"
+
+#include "salalib/genlib/pafmath.hpp"
+#include "salalib/vgamodules/vgaangular.hpp"
+#include "salalib/vgamodules/vgametric.hpp"
+#include "salalib/vgamodules/vgavisualglobal.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <random>
+
+namespace {
+    // two-sided 95% quantile of the normal distribution
+    constexpr double Z_95 = 1.959964;
+
+    // least metric distance or least angle from one source, -1 where not reached
+    class LeastCostSearch {
+        const LatticeGraphCSR &m_graph;
+        const std::vector<Point2f> &m_locations;
+        bool m_angular;
+        std::vector<uint32_t> m_parent;
+        std::vector<char> m_settled;
+        using QueueEntry = std::pair<double, uint32_t>;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>>
+            m_queue;
+
+      public:
+        LeastCostSearch(const LatticeGraphCSR &graph, const std::vector<Point2f> &locations,
+                        bool angular)
+            : m_graph(graph), m_locations(locations), m_angular(angular),
+              m_parent(graph.getCellCount()), m_settled(graph.getCellCount()) {}
+
+        void run(uint32_t source, std::vector<double> &depths) {
+            depths.assign(m_graph.getCellCount(), -1.0);
+            std::fill(m_settled.begin(), m_settled.end(), 0);
+            auto relax = [&](uint32_t cell, double cellDepth, uint32_t from) {
+                if (depths[cell] < 0 || cellDepth < depths[cell]) {
+                    depths[cell] = cellDepth;
+                    m_parent[cell] = from;
+                    m_queue.push(QueueEntry(cellDepth, cell));
+                }
+            };
+            relax(source, 0.0, LatticeGraphCSR::NO_CELL);
+            while (!m_queue.empty()) {
+                auto [cellDepth, cell] = m_queue.top();
+                m_queue.pop();
+                if (m_settled[cell]) {
+                    continue;
+                }
+                m_settled[cell] = 1;
+                for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell);
+                     ++it) {
+                    double cost = 0.0;
+                    if (!m_angular) {
+                        cost = VGAGeometry::distance(m_locations[cell], m_locations[*it]);
+                    } else if (m_parent[cell] != LatticeGraphCSR::NO_CELL) {
+                        cost = VGAGeometry::turnAngle(m_locations[m_parent[cell]],
+                                                      m_locations[cell], m_locations[*it]);
+                    }
+                    relax(*it, cellDepth + cost, cell);
+                }
+                uint32_t merge = m_graph.getMerge(cell);
+                if (merge != LatticeGraphCSR::NO_CELL) {
+                    relax(merge, cellDepth, LatticeGraphCSR::NO_CELL);
+                }
+            }
+        }
+    };
+
+    struct CellSample {
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        uint32_t count = 0;
+    };
+
+    struct Estimate {
+        double nodeCount = 1.0; // including the cell itself
+        double mean = -1.0;
+        double halfWidth = -1.0;
+    };
+
+    Estimate estimate(const CellSample &sample, size_t pivotsUsed, bool isPivot,
+                      size_t cellCount) {
+        Estimate result;
+        size_t otherPivots = pivotsUsed - (isPivot ? 1 : 0);
+        if (sample.count == 0 || otherPivots == 0) {
+            return result;
+        }
+        auto count = static_cast<double>(sample.count);
+        // the pivots not reached are outside the component of this cell
+        double population =
+            static_cast<double>(cellCount - 1) * count / static_cast<double>(otherPivots);
+        result.nodeCount = population + 1.0;
+        result.mean = sample.sum / count;
+        if (sample.count > 1) {
+            double variance =
+                std::max(0.0, (sample.sumSquares - sample.sum * result.mean) / (count - 1.0));
+            // finite population correction, which goes to zero when every point is a pivot
+            double correction =
+                population > 1.0 ? std::max(0.0, (population - count) / (population - 1.0)) : 0.0;
+            result.halfWidth = Z_95 * std::sqrt(variance / count * correction);
+        }
+        return result;
+    }
+
+    // visual integration [HH] as in VGAVisualGlobal, from mean depth and node count
+    std::optional<double> integrationHH(double meanDepth, double nodeCount) {
+        if (nodeCount <= 2.0 || meanDepth <= 1.0) {
+            return std::nullopt;
+        }
+        double ra = 2.0 * (meanDepth - 1.0) / (nodeCount - 2.0);
+        return pafmath::dvalue(nodeCount) / ra;
+    }
+} // namespace
+
+bool VGASampledDepth::run(Communicator *comm) {
+    const size_t cellCount = m_graph.getCellCount();
+    if (cellCount < 2 || (m_pivotCount == 0 && m_targetError <= 0.0) ||
+        (m_analysisType != AnalysisType::VISUAL && m_analysisType != AnalysisType::METRIC &&
+         m_analysisType != AnalysisType::ANGULAR)) {
+        return false;
+    }
+
+    // pivots are taken from a shuffled order, i.e. sampled without replacement
+    std::vector<uint32_t> pivotOrder(cellCount);
+    std::iota(pivotOrder.begin(), pivotOrder.end(), 0);
+    std::mt19937 generator(m_seed);
+    std::shuffle(pivotOrder.begin(), pivotOrder.end(), generator);
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS,
+                              m_pivotCount > 0 ? std::min(m_pivotCount, cellCount) : cellCount);
+    }
+
+    std::optional<BitmapFrontierBFS> visualSearch;
+    std::optional<LeastCostSearch> leastCostSearch;
+    std::vector<Point2f> locations;
+    if (m_analysisType == AnalysisType::VISUAL) {
+        visualSearch.emplace(m_graph);
+    } else {
+        locations = VGAGeometry::getCellLocations(m_map, m_graph);
+        leastCostSearch.emplace(m_graph, locations, m_analysisType == AnalysisType::ANGULAR);
+    }
+
+    std::vector<CellSample> samples(cellCount);
+    std::vector<char> isPivot(cellCount, 0);
+    std::vector<double> depths;
+    std::vector<int> visualDepths;
+    std::vector<size_t> distribution;
+
+    m_pivotsUsed = 0;
+    size_t batchEnd =
+        m_pivotCount > 0 ? std::min(m_pivotCount, cellCount) : std::min(FIRST_BATCH, cellCount);
+    while (true) {
+        for (; m_pivotsUsed < batchEnd; m_pivotsUsed++) {
+            uint32_t pivot = pivotOrder[m_pivotsUsed];
+            isPivot[pivot] = 1;
+            if (visualSearch.has_value()) {
+                visualSearch->run({pivot}, static_cast<size_t>(-1), distribution, &visualDepths);
+                depths.assign(visualDepths.begin(), visualDepths.end());
+            } else {
+                leastCostSearch->run(pivot, depths);
+            }
+            for (uint32_t cell = 0; cell < cellCount; cell++) {
+                if (cell != pivot && depths[cell] >= 0.0) {
+                    samples[cell].sum += depths[cell];
+                    samples[cell].sumSquares += depths[cell] * depths[cell];
+                    samples[cell].count++;
+                }
+            }
+
+            if (comm) {
+                if (qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        throw Communicator::CancelledException();
+                    }
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD, m_pivotsUsed);
+                }
+            }
+        }
+        if (m_pivotCount > 0 || m_pivotsUsed == cellCount) {
+            break;
+        }
+        double worstError = 0.0;
+        for (uint32_t cell = 0; cell < cellCount; cell++) {
+            Estimate cellEstimate =
+                estimate(samples[cell], m_pivotsUsed, isPivot[cell], cellCount);
+            if (cellEstimate.mean > 0.0) {
+                // not enough samples to say anything about the spread yet
+                if (cellEstimate.halfWidth < 0.0) {
+                    worstError = std::numeric_limits<double>::infinity();
+                    break;
+                }
+                worstError = std::max(worstError, cellEstimate.halfWidth / cellEstimate.mean);
+            }
+        }
+        if (worstError <= m_targetError) {
+            break;
+        }
+        batchEnd = std::min(batchEnd * 2, cellCount);
+    }
+
+    std::string meanColumn, countColumn;
+    if (m_analysisType == AnalysisType::VISUAL) {
+        meanColumn = VGAVisualGlobal::Column::VISUAL_MEAN_DEPTH;
+        countColumn = VGAVisualGlobal::Column::VISUAL_NODE_COUNT;
+    } else if (m_analysisType == AnalysisType::METRIC) {
+        meanColumn = VGAMetric::Column::METRIC_MEAN_SHORTEST_PATH_DISTANCE;
+        countColumn = VGAMetric::Column::METRIC_NODE_COUNT;
+    } else {
+        meanColumn = VGAAngular::Column::ANGULAR_MEAN_DEPTH;
+        countColumn = VGAAngular::Column::ANGULAR_NODE_COUNT;
+    }
+    const std::string integColumn = VGAVisualGlobal::Column::VISUAL_INTEGRATION_HH;
+    const bool withIntegration = m_analysisType == AnalysisType::VISUAL;
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(getApproxColumn(meanColumn));
+    transaction.insertOrResetColumn(getIntervalColumn(meanColumn));
+    transaction.insertOrResetColumn(getApproxColumn(countColumn));
+    if (withIntegration) {
+        transaction.insertOrResetColumn(getApproxColumn(integColumn));
+        transaction.insertOrResetColumn(getIntervalColumn(integColumn));
+    }
+    // the column order might have changed while inserting, retrieve them all again:
+    auto meanCol = transaction.getColumnIndex(getApproxColumn(meanColumn));
+    auto meanIntervalCol = transaction.getColumnIndex(getIntervalColumn(meanColumn));
+    auto countCol = transaction.getColumnIndex(getApproxColumn(countColumn));
+    size_t integCol = 0, integIntervalCol = 0;
+    if (withIntegration) {
+        integCol = transaction.getColumnIndex(getApproxColumn(integColumn));
+        integIntervalCol = transaction.getColumnIndex(getIntervalColumn(integColumn));
+    }
+
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+        if (row == nullptr) {
+            continue;
+        }
+        Estimate cellEstimate = estimate(samples[cell], m_pivotsUsed, isPivot[cell], cellCount);
+        double mean = cellEstimate.mean;
+        double halfWidth = cellEstimate.halfWidth;
+        if (m_analysisType == AnalysisType::METRIC && mean >= 0.0) {
+            // VGAMetric averages over all the points including the origin itself
+            double scale = (cellEstimate.nodeCount - 1.0) / cellEstimate.nodeCount;
+            mean *= scale;
+            halfWidth = halfWidth < 0.0 ? halfWidth : halfWidth * scale;
+        }
+        row->setValue(meanCol, static_cast<float>(mean));
+        row->setValue(meanIntervalCol, static_cast<float>(halfWidth));
+        row->setValue(countCol, static_cast<float>(std::round(cellEstimate.nodeCount)));
+        if (withIntegration) {
+            auto integ = integrationHH(mean, cellEstimate.nodeCount);
+            // integration falls as mean depth rises, so the interval ends swap over
+            auto integHigh = integrationHH(mean - halfWidth, cellEstimate.nodeCount);
+            auto integLow = integrationHH(mean + halfWidth, cellEstimate.nodeCount);
+            row->setValue(integCol, integ.has_value() ? static_cast<float>(*integ) : -1.0f);
+            row->setValue(integIntervalCol, halfWidth >= 0.0 && integHigh.has_value() &&
+                                                    integLow.has_value()
+                                                ? static_cast<float>((*integHigh - *integLow) / 2)
+                                                : -1.0f);
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Visual, metric or angular mean depth estimated from a random sample of
+// pivot origins instead of all of them. The search from a pivot gives its
+// depth to every other point, and as the depths are symmetric that is also a
+// sample of the depths from those points. Every estimate is written next to
+// the half-width of its 95% confidence interval. The pivots are either a fixed
+// number or as many as needed to bring the largest relative half-width under
+// a target error
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/analysistype.hpp"
+#include "salalib/latticemap.hpp"
+
+#include <string>
+
+class VGASampledDepth {
+  public:
+    static std::string getApproxColumn(const std::string &column) {
+        return column + " [Approx]";
+    }
+    static std::string getIntervalColumn(const std::string &column) {
+        return column + " [Approx 95% CI]";
+    }
+
+    // pivots in the first batch when working towards a target error, doubled with every batch
+    static constexpr size_t FIRST_BATCH = 32;
+
+  private:
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    AnalysisType m_analysisType;
+    size_t m_pivotCount;  // 0 to use the target error
+    double m_targetError; // relative to the estimate
+    uint32_t m_seed;
+    size_t m_pivotsUsed = 0;
+
+  public:
+    VGASampledDepth(LatticeMap &map, const LatticeGraphCSR &graph, AnalysisType analysisType,
+                    size_t pivotCount, double targetError = 0.0, uint32_t seed = 0)
+        : m_map(map), m_graph(graph), m_analysisType(analysisType), m_pivotCount(pivotCount),
+          m_targetError(targetError), m_seed(seed) {}
+    std::string getAnalysisName() const { return "Sampled Depth Analysis"; }
+    size_t getPivotsUsed() const { return m_pivotsUsed; }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,174 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgavisualfused.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "vgavisualglobalcolumns.hpp"
+
+#include "salalib/isovist.hpp"
+#include "salalib/isovistutils.hpp"
+#include "salalib/vgamodules/vgavisuallocal.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+
+std::vector<std::string> VGAVisualFused::getColumnNames(double radius, bool simpleVersion) {
+    std::vector<std::string> names = {VGAVisualLocal::Column::VISUAL_CLUSTERING_COEFFICIENT,
+                                      VGAVisualLocal::Column::VISUAL_CONTROL,
+                                      VGAVisualLocal::Column::VISUAL_CONTROLLABILITY};
+    auto globalNames = VGAVisualGlobalColumns::getColumnNames(radius, simpleVersion);
+    names.insert(names.end(), globalNames.begin(), globalNames.end());
+    return names;
+}
+
+bool VGAVisualFused::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(VGAVisualLocal::Column::VISUAL_CLUSTERING_COEFFICIENT);
+    transaction.insertOrResetColumn(VGAVisualLocal::Column::VISUAL_CONTROL);
+    transaction.insertOrResetColumn(VGAVisualLocal::Column::VISUAL_CONTROLLABILITY);
+
+    // setIsovistData names the columns itself, so the measures go into a table of their own
+    // first, and from there into pending columns of the same names. The names do not depend on
+    // the isovist, and the one of the first cell tells them
+    AttributeTable isovistTable;
+    AttributeRow &isovistRow = isovistTable.addRow(AttributeKey(0));
+    if (m_bspTree != nullptr && cellCount > 0) {
+        Isovist iso;
+        iso.makeit(m_bspTree->getRoot(), m_map.depixelate(m_graph.getRef(0)), m_region);
+        IsovistUtils::setIsovistData(iso, isovistTable, isovistRow);
+        for (size_t col = 0; col < isovistTable.getNumColumns(); col++) {
+            transaction.insertOrResetColumn(isovistTable.getColumnName(col));
+        }
+    }
+
+    VGAVisualGlobalColumns globalColumns(transaction, m_radius, m_simpleVersion);
+    auto clusterCol =
+        transaction.getColumnIndex(VGAVisualLocal::Column::VISUAL_CLUSTERING_COEFFICIENT);
+    auto controlCol = transaction.getColumnIndex(VGAVisualLocal::Column::VISUAL_CONTROL);
+    auto controllabilityCol =
+        transaction.getColumnIndex(VGAVisualLocal::Column::VISUAL_CONTROLLABILITY);
+    std::vector<size_t> isovistCols;
+    for (size_t col = 0; col < isovistTable.getNumColumns(); col++) {
+        isovistCols.push_back(transaction.getColumnIndex(isovistTable.getColumnName(col)));
+    }
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    const size_t globalDepth =
+        m_radius < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(m_radius);
+    const size_t searchDepth = getSearchDepth(m_radius);
+
+    // stamping the cells with the current origin saves clearing them for every origin
+    std::vector<uint32_t> visitedFrom(cellCount, LatticeGraphCSR::NO_CELL);
+    std::vector<uint32_t> depth(cellCount, 0);
+    std::vector<uint32_t> currLevel, nextLevel;
+    std::vector<size_t> distribution;
+
+    for (uint32_t origin = 0; origin < cellCount; origin++) {
+        if (!m_originFilter.empty() && !m_originFilter[origin]) {
+            continue;
+        }
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(origin)));
+        if (row == nullptr) {
+            continue;
+        }
+
+        auto visit = [&](uint32_t cell, uint32_t level) {
+            visitedFrom[cell] = origin;
+            depth[cell] = level;
+            nextLevel.push_back(cell);
+            uint32_t merge = m_graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL && visitedFrom[merge] != origin) {
+                visitedFrom[merge] = origin;
+                depth[merge] = level;
+                nextLevel.push_back(merge);
+            }
+        };
+
+        nextLevel.clear();
+        distribution.clear();
+        visit(origin, 0);
+
+        size_t cluster = 0;
+        float control = 0.0f;
+        size_t firstLevel = 0, secondLevel = 0;
+        size_t level = 0;
+        while (!nextLevel.empty()) {
+            if (level <= globalDepth) {
+                distribution.push_back(nextLevel.size());
+            }
+            if (level == 1) {
+                firstLevel = nextLevel.size();
+            } else if (level == 2) {
+                secondLevel = nextLevel.size();
+            }
+            if (level >= searchDepth) {
+                break;
+            }
+            std::swap(currLevel, nextLevel);
+            nextLevel.clear();
+            for (uint32_t cell : currLevel) {
+                if (level == 1 && m_graph.getConnectivity(cell) != 0) {
+                    control += 1.0f / static_cast<float>(m_graph.getConnectivity(cell));
+                }
+                for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell);
+                     ++it) {
+                    if (visitedFrom[*it] == origin) {
+                        // a link between two neighbours of the origin
+                        if (level == 1 && depth[*it] == 1) {
+                            cluster++;
+                        }
+                        continue;
+                    }
+                    visit(*it, static_cast<uint32_t>(level + 1));
+                }
+            }
+            level++;
+        }
+
+        if (firstLevel > 1) {
+            row->setValue(clusterCol, static_cast<float>(cluster) /
+                                          static_cast<float>(firstLevel * (firstLevel - 1)));
+            row->setValue(controlCol, control);
+            row->setValue(controllabilityCol, static_cast<float>(firstLevel) /
+                                                  static_cast<float>(firstLevel + secondLevel));
+        } else {
+            row->setValue(clusterCol, -1.0f);
+            row->setValue(controlCol, -1.0f);
+            row->setValue(controllabilityCol, -1.0f);
+        }
+
+        globalColumns.write(*row, distribution);
+
+        if (m_bspTree != nullptr) {
+            Isovist iso;
+            iso.makeit(m_bspTree->getRoot(), m_map.depixelate(m_graph.getRef(origin)), m_region);
+            IsovistUtils::setIsovistData(iso, isovistTable, isovistRow);
+            for (size_t col = 0; col < isovistCols.size(); col++) {
+                row->setValue(isovistCols[col], isovistRow.getValue(col));
+            }
+        }
+
+        if (comm) {
+            if (qtimer(atime, 500)) {
+                if (comm->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                comm->CommPostMessage(Communicator::CURRENT_RECORD, origin);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
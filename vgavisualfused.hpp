@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Visual local, global and (optionally) isovist measures from a single walk
+// per origin. The local measures only need the first two levels of the
+// neighbourhood, which the global breadth-first search visits anyway, so the
+// separate VGAVisualLocal and VGAVisualGlobal sweeps are folded into one
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/bspnodetree.hpp"
+#include "salalib/latticemap.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+class VGAVisualFused {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    double m_radius;
+    bool m_simpleVersion;
+    // when set, isovists are made from this tree for every origin
+    BSPNodeTree *m_bspTree;
+    Region4f m_region;
+    // when set, only the origins marked here are analysed
+    std::vector<bool> m_originFilter;
+
+  public:
+    VGAVisualFused(LatticeMap &map, const LatticeGraphCSR &graph, double radius,
+                   bool simpleVersion, BSPNodeTree *bspTree = nullptr, Region4f region = Region4f())
+        : m_map(map), m_graph(graph), m_radius(radius), m_simpleVersion(simpleVersion),
+          m_bspTree(bspTree), m_region(region) {}
+    std::string getAnalysisName() const { return "Fused Visual Analysis"; }
+    void setOriginFilter(std::vector<bool> originFilter) {
+        m_originFilter = std::move(originFilter);
+    }
+    // the levels walked from every origin: the local measures need the first two whatever the
+    // radius
+    static size_t getSearchDepth(double radius) {
+        return radius < 0 ? static_cast<size_t>(-1)
+                          : std::max(static_cast<size_t>(radius), size_t(2));
+    }
+    // the names of the local and global columns (not the isovist ones)
+    static std::vector<std::string> getColumnNames(double radius, bool simpleVersion);
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,53 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgavisualglobalbitmap.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "vgavisualglobalcolumns.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+bool VGAVisualGlobalBitmap::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    VGAVisualGlobalColumns globalColumns(transaction, m_radius, m_simpleVersion);
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    const size_t searchDepth =
+        m_radius < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(m_radius);
+    BitmapFrontierBFS bfs(m_graph, m_kernel);
+    std::vector<uint32_t> sources(1);
+    std::vector<size_t> distribution;
+
+    for (uint32_t origin = 0; origin < cellCount; origin++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(origin)));
+        if (row == nullptr) {
+            continue;
+        }
+
+        sources[0] = origin;
+        bfs.run(sources, searchDepth, distribution);
+        globalColumns.write(*row, distribution);
+
+        if (comm) {
+            if (qtimer(atime, 500)) {
+                if (comm->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                comm->CommPostMessage(Communicator::CURRENT_RECORD, origin);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
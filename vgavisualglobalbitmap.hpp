@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Visual global measures as in VGAVisualGlobal, with the search from every
+// origin done by a BitmapFrontierBFS
+
+#pragma once
+
+#include "bitmapfrontierbfs.hpp"
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+class VGAVisualGlobalBitmap {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    double m_radius;
+    bool m_simpleVersion;
+    BitmapFrontierBFS::Kernel m_kernel;
+
+  public:
+    VGAVisualGlobalBitmap(LatticeMap &map, const LatticeGraphCSR &graph, double radius,
+                          bool simpleVersion,
+                          BitmapFrontierBFS::Kernel kernel = BitmapFrontierBFS::Kernel::AUTO)
+        : m_map(map), m_graph(graph), m_radius(radius), m_simpleVersion(simpleVersion),
+          m_kernel(kernel) {}
+    std::string getAnalysisName() const { return "Global Visibility Analysis (Bitmap Frontier)"; }
+    bool run(Communicator *comm);
+};
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgavisualglobalcolumns.hpp"
+
+#include "salalib/genlib/pafmath.hpp"
+#include "salalib/vgamodules/vgavisualglobal.hpp"
+
+#include <cmath>
+
+VGAVisualGlobalColumns::VGAVisualGlobalColumns(AttributeColumnTransaction &transaction,
+                                               double radius, bool simpleVersion) {
+    using Column = VGAVisualGlobal::Column;
+    auto columnName = [radius](const char *column) {
+        return VGAVisualGlobal::getColumnWithRadius(column, radius);
+    };
+
+    transaction.insertOrResetColumn(columnName(Column::VISUAL_INTEGRATION_HH));
+    transaction.insertOrResetColumn(columnName(Column::VISUAL_MEAN_DEPTH));
+    transaction.insertOrResetColumn(columnName(Column::VISUAL_NODE_COUNT));
+    if (!simpleVersion) {
+        transaction.insertOrResetColumn(columnName(Column::VISUAL_INTEGRATION_PV));
+        transaction.insertOrResetColumn(columnName(Column::VISUAL_INTEGRATION_TEKL));
+        transaction.insertOrResetColumn(columnName(Column::VISUAL_ENTROPY));
+        transaction.insertOrResetColumn(columnName(Column::VISUAL_REL_ENTROPY));
+    }
+
+    // the column order might have changed while inserting, retrieve them all again:
+    m_integHHCol = transaction.getColumnIndex(columnName(Column::VISUAL_INTEGRATION_HH));
+    m_meanDepthCol = transaction.getColumnIndex(columnName(Column::VISUAL_MEAN_DEPTH));
+    m_countCol = transaction.getColumnIndex(columnName(Column::VISUAL_NODE_COUNT));
+    if (!simpleVersion) {
+        m_integPVCol = transaction.getColumnIndex(columnName(Column::VISUAL_INTEGRATION_PV));
+        m_integTkCol = transaction.getColumnIndex(columnName(Column::VISUAL_INTEGRATION_TEKL));
+        m_entropyCol = transaction.getColumnIndex(columnName(Column::VISUAL_ENTROPY));
+        m_relEntropyCol = transaction.getColumnIndex(columnName(Column::VISUAL_REL_ENTROPY));
+    }
+}
+
+std::vector<std::string> VGAVisualGlobalColumns::getColumnNames(double radius,
+                                                              bool simpleVersion) {
+    using Column = VGAVisualGlobal::Column;
+    std::vector<std::string> names = {Column::VISUAL_INTEGRATION_HH, Column::VISUAL_MEAN_DEPTH,
+                                      Column::VISUAL_NODE_COUNT};
+    if (!simpleVersion) {
+        names.insert(names.end(), {Column::VISUAL_INTEGRATION_PV, Column::VISUAL_INTEGRATION_TEKL,
+                                   Column::VISUAL_ENTROPY, Column::VISUAL_REL_ENTROPY});
+    }
+    for (auto &name : names) {
+        name = VGAVisualGlobal::getColumnWithRadius(name, radius);
+    }
+    return names;
+}
+
+void VGAVisualGlobalColumns::write(AttributeRow &row,
+                                   const std::vector<size_t> &distribution) const {
+    size_t totalNodes = 0;
+    size_t totalDepth = 0;
+    for (size_t k = 0; k < distribution.size(); k++) {
+        totalNodes += distribution[k];
+        totalDepth += k * distribution[k];
+    }
+
+    float integHH = -1.0f, integPV = -1.0f, integTk = -1.0f;
+    float meanDepthValue = -1.0f, entropyValue = -1.0f, relEntropyValue = -1.0f;
+    if (totalNodes > 1) {
+        double meanDepth = static_cast<double>(totalDepth) / static_cast<double>(totalNodes - 1);
+        meanDepthValue = static_cast<float>(meanDepth);
+        if (totalNodes > 2 && meanDepth > 1.0) {
+            double ra = 2.0 * (meanDepth - 1.0) / static_cast<double>(totalNodes - 2);
+            // d-value / p-values from Depthmap 4 manual, note: node_count includes this one
+            double rraD = ra / pafmath::dvalue(static_cast<double>(totalNodes));
+            double rraP = ra / pafmath::pvalue(static_cast<double>(totalNodes));
+            integHH = static_cast<float>(1.0 / rraD);
+            integPV = static_cast<float>(1.0 / rraP);
+            if (totalDepth > totalNodes) {
+                integTk = static_cast<float>(pafmath::teklinteg(static_cast<double>(totalNodes),
+                                                                static_cast<double>(totalDepth)));
+            }
+        }
+
+        double entropy = 0.0, relEntropy = 0.0, factorial = 1.0;
+        // n.b., the distribution contains the origin itself in distribution[0]
+        // -> chopped from entropy to avoid divide by zero if only one node
+        for (size_t k = 1; k < distribution.size(); k++) {
+            if (distribution[k] > 0) {
+                double prob =
+                    static_cast<double>(distribution[k]) / static_cast<double>(totalNodes - 1);
+                entropy -= prob * pafmath::log2(prob);
+                // Formula from Turner 2001, "Depthmap"
+                factorial *= static_cast<double>(k + 1);
+                double q = (pow(meanDepth, static_cast<double>(k)) / factorial) * exp(-meanDepth);
+                relEntropy += prob * pafmath::log2(prob / q);
+            }
+        }
+        entropyValue = static_cast<float>(entropy);
+        relEntropyValue = static_cast<float>(relEntropy);
+    }
+
+    row.setValue(m_integHHCol, integHH);
+    row.setValue(m_meanDepthCol, meanDepthValue);
+    row.setValue(m_countCol, static_cast<float>(totalNodes));
+    if (m_integPVCol.has_value()) {
+        row.setValue(*m_integPVCol, integPV);
+        row.setValue(*m_integTkCol, integTk);
+        row.setValue(*m_entropyCol, entropyValue);
+        row.setValue(*m_relEntropyCol, relEntropyValue);
+    }
+}
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// The global visual measures (integration, mean depth, entropy etc.) under
+// the same column names and with the same formulae as VGAVisualGlobal, so that
+// engines that produce a visual depth distribution per origin can write them
+
+#pragma once
+
+#include "attributecolumntransaction.hpp"
+
+#include "salalib/attributetable.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+class VGAVisualGlobalColumns {
+    size_t m_integHHCol;
+    size_t m_meanDepthCol;
+    size_t m_countCol;
+    std::optional<size_t> m_integPVCol = std::nullopt;
+    std::optional<size_t> m_integTkCol = std::nullopt;
+    std::optional<size_t> m_entropyCol = std::nullopt;
+    std::optional<size_t> m_relEntropyCol = std::nullopt;
+
+  public:
+    // inserts (or resets) the columns for this radius, to be committed with the transaction
+    VGAVisualGlobalColumns(AttributeColumnTransaction &transaction, double radius,
+                           bool simpleVersion);
+
+    // the names of the columns written for this radius
+    static std::vector<std::string> getColumnNames(double radius, bool simpleVersion);
+
+    size_t getIntegrationHHColumn() const { return m_integHHCol; }
+
+    // distribution[k] is the number of points at depth k, with the origin at depth 0
+    void write(AttributeRow &row, const std::vector<size_t> &distribution) const;
+};
@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgavisualglobaldepthbitmap.hpp"
+
+#include "attributecolumntransaction.hpp"
+
+#include "salalib/vgamodules/vgavisualglobaldepth.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+bool VGAVisualGlobalDepthBitmap::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+
+    std::vector<uint32_t> sources;
+    for (const PixelRef &ref : m_originRefs) {
+        uint32_t cell = m_graph.getCell(ref);
+        if (cell != LatticeGraphCSR::NO_CELL) {
+            sources.push_back(cell);
+        }
+    }
+    if (sources.empty()) {
+        return false;
+    }
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    transaction.insertOrResetColumn(VGAVisualGlobalDepth::Column::VISUAL_STEP_DEPTH);
+    auto col = transaction.getColumnIndex(VGAVisualGlobalDepth::Column::VISUAL_STEP_DEPTH);
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    std::vector<size_t> distribution;
+    std::vector<int> depths;
+    BitmapFrontierBFS(m_graph, m_kernel).run(sources, static_cast<size_t>(-1), distribution,
+                                             &depths);
+
+    if (comm && comm->IsCancelled()) {
+        throw Communicator::CancelledException();
+    }
+
+    for (uint32_t cell = 0; cell < cellCount; cell++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(cell)));
+        if (row != nullptr) {
+            row->setValue(col, static_cast<float>(depths[cell]));
+        }
+    }
+
+    if (comm) {
+        comm->CommPostMessage(Communicator::CURRENT_RECORD, cellCount);
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Visual step depth from a set of origins as in VGAVisualGlobalDepth, with
+// the search done by a BitmapFrontierBFS
+
+#pragma once
+
+#include "bitmapfrontierbfs.hpp"
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAVisualGlobalDepthBitmap {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<PixelRef> m_originRefs;
+    BitmapFrontierBFS::Kernel m_kernel;
+
+  public:
+    VGAVisualGlobalDepthBitmap(LatticeMap &map, const LatticeGraphCSR &graph,
+                               std::set<PixelRef> originRefs,
+                               BitmapFrontierBFS::Kernel kernel = BitmapFrontierBFS::Kernel::AUTO)
+        : m_map(map), m_graph(graph), m_originRefs(std::move(originRefs)), m_kernel(kernel) {}
+    std::string getAnalysisName() const { return "Visual Step Depth (Bitmap Frontier)"; }
+    bool run(Communicator *comm);
+};
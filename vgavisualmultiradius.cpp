@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "vgavisualmultiradius.hpp"
+
+#include "attributecolumntransaction.hpp"
+#include "vgavisualglobalcolumns.hpp"
+
+#include "salalib/genlib/comm.hpp"
+
+#include <algorithm>
+
+bool VGAVisualGlobalMultiRadius::run(Communicator *comm) {
+    const auto cellCount = static_cast<uint32_t>(m_graph.getCellCount());
+
+    auto &attributes = m_map.getAttributeTable();
+    AttributeColumnTransaction transaction(attributes);
+    std::vector<VGAVisualGlobalColumns> radiusColumns;
+    std::vector<size_t> radiusDepths;
+    size_t searchDepth = 0;
+    for (double radius : m_radiusSet) {
+        radiusColumns.emplace_back(transaction, radius, m_simpleVersion);
+        radiusDepths.push_back(radius < 0 ? static_cast<size_t>(-1) : static_cast<size_t>(radius));
+        searchDepth = std::max(searchDepth, radiusDepths.back());
+    }
+
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, cellCount);
+    }
+
+    std::vector<uint32_t> visitedFrom(cellCount, LatticeGraphCSR::NO_CELL);
+    std::vector<uint32_t> currLevel, nextLevel;
+    std::vector<size_t> distribution, radiusDistribution;
+
+    for (uint32_t origin = 0; origin < cellCount; origin++) {
+        AttributeRow *row = attributes.getRowPtr(AttributeKey(m_graph.getRef(origin)));
+        if (row == nullptr) {
+            continue;
+        }
+
+        auto visit = [&](uint32_t cell) {
+            visitedFrom[cell] = origin;
+            nextLevel.push_back(cell);
+            uint32_t merge = m_graph.getMerge(cell);
+            if (merge != LatticeGraphCSR::NO_CELL && visitedFrom[merge] != origin) {
+                visitedFrom[merge] = origin;
+                nextLevel.push_back(merge);
+            }
+        };
+
+        nextLevel.clear();
+        distribution.clear();
+        visit(origin);
+        while (!nextLevel.empty()) {
+            distribution.push_back(nextLevel.size());
+            if (distribution.size() > searchDepth) {
+                break;
+            }
+            std::swap(currLevel, nextLevel);
+            nextLevel.clear();
+            for (uint32_t cell : currLevel) {
+                for (auto it = m_graph.neighboursBegin(cell); it != m_graph.neighboursEnd(cell);
+                     ++it) {
+                    if (visitedFrom[*it] != origin) {
+                        visit(*it);
+                    }
+                }
+            }
+        }
+
+        // every radius sees the distribution up to its own depth
+        for (size_t r = 0; r < radiusColumns.size(); r++) {
+            size_t levels = radiusDepths[r] < distribution.size() ? radiusDepths[r] + 1
+                                                                   : distribution.size();
+            radiusDistribution.assign(distribution.begin(),
+                                      distribution.begin() + static_cast<long>(levels));
+            radiusColumns[r].write(*row, radiusDistribution);
+        }
+
+        if (comm) {
+            if (qtimer(atime, 500)) {
+                if (comm->IsCancelled()) {
+                    throw Communicator::CancelledException();
+                }
+                comm->CommPostMessage(Communicator::CURRENT_RECORD, origin);
+            }
+        }
+    }
+
+    transaction.commit();
+    return true;
+}
@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Visual global measures for a whole set of radii from one breadth-first
+// search per origin. The search goes out to the largest radius and the depth
+// distribution is cut at every radius to produce its columns, which are the
+// same as those of VGAVisualGlobal for that radius
+
+#pragma once
+
+#include "latticegraphcsr.hpp"
+
+#include "salalib/latticemap.hpp"
+
+#include <set>
+
+class VGAVisualGlobalMultiRadius {
+    LatticeMap &m_map;
+    const LatticeGraphCSR &m_graph;
+    std::set<double> m_radiusSet; // -1 for radius n
+    bool m_simpleVersion;
+
+  public:
+    VGAVisualGlobalMultiRadius(LatticeMap &map, const LatticeGraphCSR &graph,
+                               std::set<double> radiusSet, bool simpleVersion)
+        : m_map(map), m_graph(graph), m_radiusSet(std::move(radiusSet)),
+          m_simpleVersion(simpleVersion) {}
+    std::string getAnalysisName() const { return "Global Visibility Analysis (Multiple Radii)"; }
+    bool run(Communicator *comm);
+};
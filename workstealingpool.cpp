@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "workstealingpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+WorkStealingPool::WorkStealingPool(size_t threadCount) : m_threadCount(threadCount) {
+    if (m_threadCount == 0) {
+        m_threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t, size_t)> &task,
+                                   Communicator *comm) {
+    if (count == 0) {
+        return;
+    }
+    time_t atime = 0;
+    if (comm) {
+        qtimer(atime, 0);
+        comm->CommPostMessage(Communicator::NUM_RECORDS, count);
+    }
+
+    const size_t workerCount = std::min(m_threadCount, count);
+    if (workerCount <= 1) {
+        for (size_t index = 0; index < count; index++) {
+            task(index, 0);
+            if (comm) {
+                if (qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        throw Communicator::CancelledException();
+                    }
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD, index + 1);
+                }
+            }
+        }
+        return;
+    }
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<WorkQueue> queues(workerCount);
+    for (size_t worker = 0; worker < workerCount; worker++) {
+        for (size_t index = count * worker / workerCount;
+             index < count * (worker + 1) / workerCount; index++) {
+            queues[worker].tasks.push_back(index);
+        }
+    }
+
+    std::atomic<size_t> done(0);
+    std::atomic<bool> stop(false);
+    std::mutex failureMutex;
+    std::exception_ptr failure;
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+
+    auto takeTask = [&](size_t worker, size_t &index) {
+        {
+            std::lock_guard<std::mutex> lock(queues[worker].mutex);
+            if (!queues[worker].tasks.empty()) {
+                index = queues[worker].tasks.back();
+                queues[worker].tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < workerCount; k++) {
+            auto &victim = queues[(worker + k) % workerCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                index = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto work = [&](size_t worker) {
+        size_t index = 0;
+        while (!stop && takeTask(worker, index)) {
+            try {
+                task(index, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+                stop = true;
+            }
+            done++;
+        }
+        std::lock_guard<std::mutex> lock(waitMutex);
+        waitCondition.notify_one();
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workerCount);
+    for (size_t worker = 0; worker < workerCount; worker++) {
+        threads.emplace_back(work, worker);
+    }
+
+    bool cancelled = false;
+    {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        while (done < count && !stop) {
+            waitCondition.wait_for(lock, std::chrono::milliseconds(100));
+            if (comm) {
+                if (qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        cancelled = true;
+                        stop = true;
+                        break;
+                    }
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD, done);
+                }
+            }
+        }
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (cancelled) {
+        throw Communicator::CancelledException();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2024 Petros Koutsolampros
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// A fork-join pool for coarse tasks. Every worker starts with an even,
+// contiguous share of the task indices in its own queue, takes work from the
+// back of it and, once that is empty, steals from the front of the others.
+// The calling thread waits, reports the progress and checks for cancellation
+// while the workers run, so the Communicator is only ever used from there
+
+#pragma once
+
+#include "salalib/genlib/comm.hpp"
+
+#include <functional>
+
+class WorkStealingPool {
+    size_t m_threadCount;
+
+  public:
+    // 0 for as many threads as the hardware runs at once
+    explicit WorkStealingPool(size_t threadCount = 0);
+    size_t getThreadCount() const { return m_threadCount; }
+
+    // Runs task(index, worker) for every index below count, with worker below getThreadCount()
+    // so that tasks may keep scratch space per worker. Throws Communicator::CancelledException
+    // when cancelled, and the first exception thrown by a task once the other workers stop
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)> &task,
+                     Communicator *comm = nullptr);
+};